@@ -0,0 +1,58 @@
+#include <cmath>
+#include "Bid.hpp"
+
+csv::Dictionary Bid::titles;
+csv::Dictionary Bid::funds;
+
+Bid::Bid(void)
+  : bidId(0), title(0), fund(0), amount(0)
+{
+}
+
+Bid::Bid(std::string_view bidId, std::string_view title,
+         std::string_view fund, double amount)
+  : bidId(parseId(bidId)), title(titles.code(title)), fund(funds.code(fund)),
+    amount(std::llround(amount * 100))
+{
+}
+
+/*
+** From numbers already decoded, a snapshot's : nothing to parse or round
+*/
+Bid::Bid(uint32_t bidId, std::string_view title,
+         std::string_view fund, int64_t amount)
+  : bidId(bidId), title(titles.code(title)), fund(funds.code(fund)), amount(amount)
+{
+}
+
+bool Bid::empty(void) const
+{
+    return bidId == 0;
+}
+
+const std::string &Bid::getTitle(void) const
+{
+    return titles.value(title);
+}
+
+const std::string &Bid::getFund(void) const
+{
+    return funds.value(fund);
+}
+
+double Bid::getAmount(void) const
+{
+    return amount / 100.0;
+}
+
+/*
+** Auction id typed by a user or read from a CSV file, 0 if it is not one
+*/
+uint32_t Bid::parseId(std::string_view text)
+{
+    long long id = csv::parseInt(text);
+
+    if (id <= 0 || id > UINT32_MAX)
+        return 0;
+    return static_cast<uint32_t>(id);
+}
@@ -0,0 +1,110 @@
+#ifndef     _BIDSNAPSHOT_HPP_
+# define    _BIDSNAPSHOT_HPP_
+
+# include <cstdint>
+# include <stdexcept>
+# include <string>
+# include <string_view>
+# include <vector>
+
+# include "CSVparser.hpp"
+
+/*
+** Binary snapshot of the bids extracted from a CSV file, so a restart
+** maps the extracted records instead of parsing the CSV again.
+**
+**   header   magic, record count, heap size, how far the CSV was read,
+**            size and mtime of the CSV and of its tombstone file
+**   records  one fixed-width record per bid : id, amount in cents,
+**            heap offset and the lengths of the title and fund there
+**   heap     the title and fund bytes of every bid, back to back
+**
+** Numbers are in the byte order of the machine that wrote the file, it
+** is a local cache and not an exchange format.
+*/
+namespace snapshot
+{
+    class Error : public std::runtime_error
+    {
+
+      public:
+        Error(const std::string &msg):
+          std::runtime_error(std::string("Snapshot : ").append(msg))
+        {
+        }
+    };
+
+    struct Entry
+    {
+        uint32_t bidId;
+        std::string_view title;
+        std::string_view fund;
+        int64_t amount; // in cents
+    };
+
+    /*
+    ** Fixed-width part of a bid, read as it is : its numbers need no
+    ** parsing, its strings are at offset in the heap
+    */
+    struct Record
+    {
+        uint32_t bidId;
+        uint32_t titleLength;
+        uint32_t fundLength;
+        uint32_t unused;
+        int64_t amount;
+        uint64_t offset;
+    };
+
+    /*
+    ** Collects bids and writes the snapshot on commit(), through a
+    ** temporary file renamed over the target. Nothing is written if the
+    ** writer is destroyed without commit(). Given how much of the CSV
+    ** the bids were read from, the snapshot is up to date while the file
+    ** is as it was at commit() and holds no whole line past that point.
+    */
+    class Writer
+    {
+
+    public:
+        Writer(const std::string &path, const std::string &source);
+
+    public:
+        void add(uint32_t bidId, std::string_view title,
+                 std::string_view fund, int64_t amount);
+        void commit(std::uint64_t sourceSize);
+
+    private:
+        std::string _path;
+        std::string _source;
+        std::vector<Record> _records;
+        std::string _heap;
+    };
+
+    /*
+    ** Maps a snapshot and hands out its bids as views into the mapping
+    */
+    class Reader
+    {
+
+    public:
+        Reader(const std::string &path);
+
+    public:
+        unsigned int size(void) const;
+        std::uint64_t sourceSize(void) const;
+        Entry operator[](unsigned int) const;
+
+    private:
+        csv::MappedFile _mapped;
+        const Record *_records;
+        const char *_heap;
+        uint64_t _count;
+        uint64_t _heapSize;
+        uint64_t _sourceSize;
+    };
+
+    bool upToDate(const std::string &path, const std::string &source);
+}
+
+#endif /*!_BIDSNAPSHOT_HPP_*/
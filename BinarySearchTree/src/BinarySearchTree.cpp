@@ -8,10 +8,20 @@
 // Date        : July 31, 2021
 //============================================================================
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <random>
+#include <span>
+#include <string_view>
 #include <time.h>
+#include <utility>
+#include <vector>
 
+#include "Bid.hpp"
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
+#include "Interleave.hpp"
 
 using namespace std;
 
@@ -19,19 +29,8 @@ using namespace std;
 // Global definitions visible to all methods and classes
 //============================================================================
 
-// forward declarations
-double strToDouble(string str, char ch);
-
-// define a structure to hold bid information
-struct Bid {
-    string bidId; // unique identifier
-    string title;
-    string fund;
-    double amount;
-    Bid() {
-        amount = 0.0;
-    }
-};
+// lookups of SearchInterleaved in flight at once
+const size_t INTERLEAVE_WIDTH = 16;
 
 // Internal structure for tree node
 struct Node {
@@ -47,10 +46,16 @@ struct Node {
 	}
 
 	// define a constructor that takes a bid, calling default constructor first
-	Node(Bid aBid): Node(){
+	Node(const Bid &aBid): Node(){
 		this->bid = aBid;
 
 	}
+
+	// build the bid in place from the arguments of one of its constructors
+	template<typename... Args>
+	Node(std::in_place_t, Args&&... args)
+	  : bid(std::forward<Args>(args)...), left(nullptr), right(nullptr) {
+	}
 };
 
 //============================================================================
@@ -66,17 +71,25 @@ class BinarySearchTree {
 private:
     Node* root;
 
-    void addNode(Node* node, Bid bid);
+    void addNode(Node* node, Node* child);
     void inOrder(Node* node);
-    Node* removeNode(Node* node, string bidId);
+    Node* removeNode(Node* node, unsigned int bidId);
+    interleave::Lookup interleavedSearch(unsigned int bidId) const;
 
 public:
     BinarySearchTree();
     virtual ~BinarySearchTree();
+    void Clear();
     void InOrder();
-    void Insert(Bid bid);
-    void Remove(string bidId);
-    Bid Search(string bidId);
+    const Bid &Insert(const Bid &bid);
+    template<typename... Args>
+    const Bid &Emplace(Args&&... args);
+    void Remove(unsigned int bidId);
+    void Remove(string_view bidId);
+    const Bid *Search(unsigned int bidId) const;
+    const Bid *Search(string_view bidId) const;
+    void SearchInterleaved(span<const unsigned int> bidIds, span<const Bid*> bids,
+            size_t width = INTERLEAVE_WIDTH) const;
 };
 
 /**
@@ -92,6 +105,30 @@ BinarySearchTree::BinarySearchTree() {
  */
 BinarySearchTree::~BinarySearchTree() {
     // recurse from root deleting every node
+	Clear();
+}
+
+/**
+ * Remove every bid
+ */
+void BinarySearchTree::Clear() {
+	// with a stack of its own : bids loaded in id order make one long branch
+	vector<Node*> nodes;
+	if (root != nullptr) {
+		nodes.push_back(root);
+	}
+	while (!nodes.empty()) {
+		Node* node = nodes.back();
+		nodes.pop_back();
+		if (node->left != nullptr) {
+			nodes.push_back(node->left);
+		}
+		if (node->right != nullptr) {
+			nodes.push_back(node->right);
+		}
+		delete node;
+	}
+	root = nullptr;
 }
 
 /**
@@ -101,44 +138,70 @@ void BinarySearchTree::InOrder() {
 }
 /**
  * Insert a bid
+ *
+ * @return The bid as stored in the tree
  */
-void BinarySearchTree::Insert(Bid bid) {
+const Bid &BinarySearchTree::Insert(const Bid &bid) {
+	return Emplace(bid);
+}
+
+/**
+ * Insert a bid built in its node from the arguments of one of its
+ * constructors, the node is then only linked into the tree
+ *
+ * @return The bid as stored in the tree
+ */
+template<typename... Args>
+const Bid &BinarySearchTree::Emplace(Args&&... args) {
     // Implement inserting a bid into the tree
+	Node* child = new Node(std::in_place, std::forward<Args>(args)...);
 	if (root == nullptr){
-		root = new Node(bid);
+		root = child;
 	} else {
-        this->addNode(root, bid);
+        this->addNode(root, child);
 	}
+	return child->bid;
 }
 
 /**
  * Remove a bid
  */
-void BinarySearchTree::Remove(string bidId) {
+void BinarySearchTree::Remove(unsigned int bidId) {
     // Implement removing a bid from the tree
-	this->removeNode(root, bidId);
+	root = removeNode(root, bidId);
 
 
 
 }
 
+/**
+ * Remove a bid
+ *
+ * @param bidId The bid id to remove, as typed
+ */
+void BinarySearchTree::Remove(string_view bidId) {
+	Remove(Bid::parseId(bidId));
+}
+
 /**
  * Search for a bid
+ *
+ * @return The bid in the tree, nullptr if there is none
  */
-Bid BinarySearchTree::Search(string bidId) {
+const Bid *BinarySearchTree::Search(unsigned int bidId) const {
     //  Implement searching the tree for a bid
 	// start searching from the root
-	Node* current = root;
+	const Node* current = root;
 
 	// keep looping downwards until bottom is reached or bid is found
 	// while current is not null, meaning we have something
      while(current != nullptr){
     	 // determine if we have a match, if so, return it
-          if(current->bid.bidId.compare(bidId) == 0){
-        	  return current->bid;
+          if(current->bid.bidId == bidId){
+        	  return &current->bid;
           }
           // if bid is smaller than current, then traverse the left hand side
-          if(bidId.compare(current->bid.bidId) < 0){
+          if(bidId < current->bid.bidId){
         	  current = current->left;
         	  // else it is larger than current
           } else {
@@ -148,37 +211,82 @@ Bid BinarySearchTree::Search(string bidId) {
      }
 
 
-	Bid bid;
-    return bid;
+    return nullptr;
+}
+
+/**
+ * Search for a bid
+ *
+ * @param bidId The bid id to search for, as typed
+ * @return The bid in the tree, nullptr if there is none
+ */
+const Bid *BinarySearchTree::Search(string_view bidId) const {
+	return Search(Bid::parseId(bidId));
+}
+
+/**
+ * Search for a bid as a coroutine, suspended after the prefetch of each
+ * node on the way down : the walk is a chain of dependent loads, the
+ * other lookups run while a node comes from memory
+ *
+ * @param bidId The bid id to search for
+ * @return The lookup, its result the bid or nullptr
+ */
+interleave::Lookup BinarySearchTree::interleavedSearch(unsigned int bidId) const {
+	const Node* current = root;
+	while (current != nullptr) {
+		co_await interleave::Prefetch{ current };
+		if (current->bid.bidId == bidId) {
+			co_return &current->bid;
+		}
+		current = bidId < current->bid.bidId ? current->left : current->right;
+	}
+	co_return nullptr;
+}
+
+/**
+ * Search for many bids at once, with a number of lookups in flight that
+ * take turns while the others wait on memory
+ *
+ * @param bidIds The bid ids to search for
+ * @param bids Where to put the bid of each id, nullptr if there is none,
+ *        as many as there are ids
+ * @param width How many lookups to have in flight
+ */
+void BinarySearchTree::SearchInterleaved(span<const unsigned int> bidIds, span<const Bid*> bids,
+		size_t width) const {
+	interleave::run(bidIds, bids, width, [this](unsigned int bidId) {
+		return interleavedSearch(bidId);
+	});
 }
 
 /**
- * Add a bid to some node (recursive)
+ * Add a node holding a bid below some node (recursive)
  *
  * @param node Current node in tree
- * @param bid Bid to be added
+ * @param child Node of the bid to be added
  */
-void BinarySearchTree::addNode(Node* node, Bid bid) {
+void BinarySearchTree::addNode(Node* node, Node* child) {
     //  Implement inserting a bid into the tree
 	// if this node is larger than the bid, add to left subtree
-	if(node->bid.bidId.compare(bid.bidId) > 0){
+	if(node->bid.bidId > child->bid.bidId){
 		// check to see if there are any children in the left side
 		if(node->left== nullptr){
-			// if no children, make a new node on the left
-			node->left = new Node(bid);
+			// if no children, the new node goes on the left
+			node->left = child;
 			// if node has children, repeat the call to addNode
 		} else {
-			this->addNode(node->left, bid);
+			this->addNode(node->left, child);
 		}
 
      // add to right subtree
 	} else {
 		if(node->right== nullptr){
-					// if no children, make a new node on the right
-					node->right = new Node(bid);
+					// if no children, the new node goes on the right
+					node->right = child;
 					// if node has children, repeat the call to addNode
 				} else {
-					this->addNode(node->right, bid);
+					this->addNode(node->right, child);
 				}
 	}
 }
@@ -187,7 +295,7 @@ void BinarySearchTree::addNode(Node* node, Bid bid) {
 void BinarySearchTree::inOrder(Node* node) {
 }
 
-Node* BinarySearchTree::removeNode(Node* node, string bidId){
+Node* BinarySearchTree::removeNode(Node* node, unsigned int bidId){
 	// if this node is null, then return (avoid crashing)
 
 	if (node == nullptr) {
@@ -195,9 +303,9 @@ Node* BinarySearchTree::removeNode(Node* node, string bidId){
 	}
 
 	// recurse down left subtree
-	if (bidId.compare(node->bid.bidId) < 0) {
+	if (bidId < node->bid.bidId) {
 		node->left = removeNode(node->left, bidId);
-	} else if (bidId.compare(node->bid.bidId) > 0){
+	} else if (bidId > node->bid.bidId){
 		node->right = removeNode(node->right, bidId);
 	} else {
 		// no children so this is a leaf node
@@ -238,9 +346,9 @@ Node* BinarySearchTree::removeNode(Node* node, string bidId){
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
-    cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
-            << bid.fund << endl;
+void displayBid(const Bid &bid) {
+    cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount() << " | "
+            << bid.getFund() << endl;
     return;
 }
 
@@ -248,53 +356,258 @@ void displayBid(Bid bid) {
  * Load a CSV file containing bids into a container
  *
  * @param csvPath the path to the CSV file to load
- * @return a container holding all the bids read
+ * @return how far the CSV file was read, to load the bids appended later
  */
-void loadBids(string csvPath, BinarySearchTree* bst) {
+uint64_t loadBids(string csvPath, BinarySearchTree* bst) {
+    // a snapshot of the bids is kept next to the CSV file and mapped
+    // instead of parsing the file again, as long as the file is unchanged
+    string snapPath = csvPath + ".snap";
+    if (snapshot::upToDate(snapPath, csvPath)) {
+        cout << "Loading snapshot " << snapPath << endl;
+        try {
+            snapshot::Reader snap(snapPath);
+            for (unsigned int i = 0; i < snap.size(); i++) {
+                snapshot::Entry entry = snap[i];
+                bst->Emplace(entry.bidId, entry.title, entry.fund, entry.amount);
+            }
+            return snap.sourceSize();
+        } catch (snapshot::Error &e) {
+            std::cerr << e.what() << std::endl;
+            // the bids read so far go, the CSV file is read instead
+            bst->Clear();
+        }
+    }
+
     cout << "Loading CSV file " << csvPath << endl;
 
-    // initialize the CSV Parser using the given path
-    csv::Parser file = csv::Parser(csvPath);
+    // stream the CSV file using the given path, one block at a time, so
+    // bids are inserted while the rest of the file is still being read
+    csv::Stream file(csvPath);
+
+    // the file may still be written to : a last line without its newline
+    // is left for loadNewBids, which reads on from where this load stops.
+    // A malformed row is skipped rather than ending the load
+    file.setFollow(true);
+    file.setErrorMode(csv::eLENIENT);
 
     // read and display header row - optional
-    vector<string> header = file.getHeader();
+    const vector<string>& header = file.getHeader();
     for (auto const& c : header) {
         cout << c << " | ";
     }
     cout << "" << endl;
 
+    // the snapshot is written again once the whole file has been read
+    snapshot::Writer writer(snapPath, csvPath);
+
     try {
-        // loop to read rows of a CSV file
-        for (unsigned int i = 0; i < file.rowCount(); i++) {
+        // decode the rows of the CSV file straight into a bid as they
+        // are read
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
 
-            // Create a data structure and add to the collection of bids
-            Bid bid;
-            bid.bidId = file[i][1];
-            bid.title = file[i][0];
-            bid.fund = file[i][8];
-            bid.amount = strToDouble(file[i][4], '$');
+            //cout << "Item: " << bid.getTitle() << ", Fund: " << bid.getFund() << ", Amount: " << bid.getAmount() << endl;
 
-            //cout << "Item: " << bid.title << ", Fund: " << bid.fund << ", Amount: " << bid.amount << endl;
+            writer.add(bid.bidId, bid.getTitle(), bid.getFund(), bid.amount);
 
             // push this bid to the end
             bst->Insert(bid);
         }
+        writer.commit(file.consumed());
     } catch (csv::Error &e) {
         std::cerr << e.what() << std::endl;
+    } catch (snapshot::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
     }
+    return file.offset();
 }
 
 /**
- * Simple C function to convert a string to a double
- * after stripping out unwanted char
+ * Load the bids appended to a CSV file since it was last read, like
+ * tail -f : only the new part of the file is read
  *
- * credit: http://stackoverflow.com/a/24875936
+ * @param csvPath the path to the CSV file to load
+ * @param offset how far the CSV file was read last time
+ * @return how far the CSV file is read now
+ */
+uint64_t loadNewBids(string csvPath, uint64_t offset, BinarySearchTree* bst) {
+    csv::Stream file(csvPath);
+    file.setFollow(true);
+    file.setErrorMode(csv::eLENIENT);
+    unsigned int count = 0;
+
+    try {
+        file.seek(offset);
+
+        // loop over the complete rows written since
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            bst->Insert(bid);
+            count++;
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
+    }
+
+    cout << count << " new bids read" << endl;
+    return file.offset();
+}
+
+/**
+ * Time loading the bids of a CSV file into a new tree and looking every
+ * one of them up again, the bids being handed out by reference or, as
+ * Search used to, copied out
  *
- * @param ch The character to strip out
+ * @param csvPath the path to the CSV file to read
  */
-double strToDouble(string str, char ch) {
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    return atof(str.c_str());
+void timeLoadAndQuery(string csvPath) {
+    const int passes = 20;
+
+    // decode the file first, so only the tree is timed
+    vector<Bid> bids;
+    try {
+        csv::Stream file(csvPath);
+        file.setErrorMode(csv::eLENIENT);
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            bids.push_back(bid);
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    BinarySearchTree* bst = new BinarySearchTree();
+
+    clock_t ticks = clock();
+    for (const Bid& bid : bids) {
+        bst->Insert(bid);
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "insert: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    int64_t byReference = 0;
+    ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Bid& bid : bids) {
+            const Bid* found = bst->Search(bid.bidId);
+            if (found != nullptr) {
+                byReference += found->amount;
+            }
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "search by reference: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    int64_t byCopy = 0;
+    ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Bid& bid : bids) {
+            const Bid* found = bst->Search(bid.bidId);
+            Bid copy;
+            if (found != nullptr) {
+                copy = *found;
+            }
+            byCopy += copy.amount;
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "search with a copy: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    cout << passes << " x " << bids.size() << " searches, totals "
+            << byReference << " / " << byCopy << endl;
+
+    delete bst;
+}
+
+/**
+ * Look up random ids in trees of more and more bids, inserted in random
+ * order, one Search at a time and then by SearchInterleaved with more
+ * and more lookups in flight, in requests of a thousand ids. A node
+ * takes 40 bytes : the largest tree, some 160 MB, is well past the size
+ * of the processor caches
+ */
+void timeInterleavedSearch() {
+    const size_t lookups = 1 << 21;
+    const size_t request = 1000;
+
+    mt19937 random(260);
+    vector<const Bid*> found(request);
+
+    for (unsigned int count : { 1u << 16, 1u << 20, 1u << 22 }) {
+        vector<unsigned int> ids(count);
+        for (unsigned int i = 0; i < count; ++i) {
+            ids[i] = i + 1;
+        }
+        shuffle(ids.begin(), ids.end(), random);
+
+        BinarySearchTree* bst = new BinarySearchTree();
+        Bid bid;
+        for (unsigned int id : ids) {
+            bid.bidId = id;
+            bid.amount = id;
+            bst->Insert(bid);
+        }
+
+        // one id in eight is not in the tree
+        ids.resize(lookups);
+        uniform_int_distribution<unsigned int> pick(1, count + count / 8);
+        for (unsigned int& id : ids) {
+            id = pick(random);
+        }
+
+        int64_t single = 0;
+        clock_t ticks = clock();
+        for (unsigned int id : ids) {
+            const Bid* found = bst->Search(id);
+            if (found != nullptr) {
+                single += found->amount;
+            }
+        }
+        ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+        double singleSeconds = ticks * 1.0 / CLOCKS_PER_SEC;
+
+        cout << count << " bids:" << endl;
+        cout << "  Search: " << singleSeconds << " seconds, "
+                << lookups / singleSeconds / 1e6 << " M lookups/s" << endl;
+
+        for (size_t width : { 4, 8, 16, 32 }) {
+            int64_t interleaved = 0;
+            ticks = clock();
+            for (size_t first = 0; first < ids.size(); first += request) {
+                size_t n = min(request, ids.size() - first);
+                bst->SearchInterleaved(span<const unsigned int>(&ids[first], n),
+                        span<const Bid*>(found.data(), n), width);
+                for (size_t i = 0; i < n; ++i) {
+                    if (found[i] != nullptr) {
+                        interleaved += found[i]->amount;
+                    }
+                }
+            }
+            ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+            double seconds = ticks * 1.0 / CLOCKS_PER_SEC;
+
+            cout << "  SearchInterleaved, " << width << " in flight: " << seconds << " seconds, "
+                    << lookups / seconds / 1e6 << " M lookups/s, "
+                    << singleSeconds / seconds << " times faster" << endl;
+            if (single != interleaved) {
+                cout << "  totals differ: " << single << " / " << interleaved << endl;
+            }
+        }
+
+        delete bst;
+    }
 }
 
 /**
@@ -324,7 +637,10 @@ int main(int argc, char* argv[]) {
     // Define a binary search tree to hold all bids
     BinarySearchTree* bst;
 
-    Bid bid;
+    const Bid* bid;
+
+    // how far the CSV file has been read
+    uint64_t csvOffset = 0;
 
     int choice = 0;
     while (choice != 9) {
@@ -333,6 +649,9 @@ int main(int argc, char* argv[]) {
         cout << "  2. Display All Bids" << endl;
         cout << "  3. Find Bid" << endl;
         cout << "  4. Remove Bid" << endl;
+        cout << "  5. Load New Bids" << endl;
+        cout << "  6. Time Load and Query" << endl;
+        cout << "  7. Interleaved Search" << endl;
         cout << "  9. Exit" << endl;
         cout << "Enter choice: ";
         cin >> choice;
@@ -346,7 +665,7 @@ int main(int argc, char* argv[]) {
             ticks = clock();
 
             // Complete the method call to load the bids
-            loadBids(csvPath, bst);
+            csvOffset = loadBids(csvPath, bst);
 
             //cout << bst->Size() << " bids read" << endl;
 
@@ -367,8 +686,8 @@ int main(int argc, char* argv[]) {
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (bid != nullptr) {
+                displayBid(*bid);
             } else {
             	cout << "Bid Id " << bidKey << " not found." << endl;
             }
@@ -381,6 +700,24 @@ int main(int argc, char* argv[]) {
         case 4:
             bst->Remove(bidKey);
             break;
+
+        case 5:
+            ticks = clock();
+
+            csvOffset = loadNewBids(csvPath, csvOffset, bst);
+
+            ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+            cout << "time: " << ticks << " clock ticks" << endl;
+            cout << "time: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+            break;
+
+        case 6:
+            timeLoadAndQuery(csvPath);
+            break;
+
+        case 7:
+            timeInterleavedSearch();
+            break;
         }
     }
 
@@ -0,0 +1,214 @@
+#ifndef     _INTERLEAVE_HPP_
+# define    _INTERLEAVE_HPP_
+
+# include <coroutine>
+# include <cstddef>
+# include <exception>
+# include <new>
+# include <span>
+# include <utility>
+# include <vector>
+
+# include "Bid.hpp"
+
+/*
+** Lookups written as coroutines, which prefetch the next node they are
+** to read and suspend, and a scheduler that keeps a number of them in
+** flight, resuming each in turn : while one waits on memory the others
+** go on, so their cache misses overlap. It is what a batched search does
+** for a hash table, for structures such as trees and chains whose next
+** address is only known once the last node has been read.
+**
+** A Lookup runs up to its first suspension as soon as it is called, and
+** is then only resumed by run.
+*/
+namespace interleave
+{
+    namespace detail
+    {
+        // the frames of finished lookups, for the next ones of the thread
+        struct Frame
+        {
+            Frame *next;
+            std::size_t size;
+        };
+
+        /*
+        ** The released frames of a thread, freed when the thread exits
+        */
+        struct Frames
+        {
+            Frame *head = nullptr;
+
+            ~Frames()
+            {
+                while (head != nullptr)
+                {
+                    Frame *frame = head;
+                    head = frame->next;
+                    ::operator delete(frame);
+                }
+            }
+        };
+
+        inline thread_local Frames frames;
+
+        /*
+        ** A frame of the same size out of those released, the lookups run
+        ** together being mostly of one kind, else a new one
+        */
+        inline void *allocate(std::size_t size)
+        {
+            for (Frame **link = &frames.head; *link != nullptr; link = &(*link)->next)
+            {
+                Frame *frame = *link;
+                if (frame->size == size)
+                {
+                    *link = frame->next;
+                    return frame + 1;
+                }
+            }
+
+            Frame *frame = static_cast<Frame *>(::operator new(sizeof(Frame) + size));
+            frame->size = size;
+            return frame + 1;
+        }
+
+        inline void release(void *memory)
+        {
+            Frame *frame = static_cast<Frame *>(memory) - 1;
+
+            frame->next = frames.head;
+            frames.head = frame;
+        }
+    }
+
+    /*
+    ** A lookup in flight, and the bid it found once it is done
+    */
+    class Lookup
+    {
+
+      public:
+        struct promise_type
+        {
+            const Bid *bid = nullptr;
+
+            Lookup get_return_object(void)
+            {
+                return Lookup(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_never initial_suspend(void) noexcept { return {}; }
+            std::suspend_always final_suspend(void) noexcept { return {}; }
+            void return_value(const Bid *found) { bid = found; }
+            void unhandled_exception(void) { std::terminate(); }
+
+            static void *operator new(std::size_t size) { return detail::allocate(size); }
+            static void operator delete(void *frame) { detail::release(frame); }
+        };
+
+        Lookup(Lookup &&other) noexcept
+          : _handle(std::exchange(other._handle, nullptr))
+        {
+        }
+
+        Lookup &operator=(Lookup &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_handle)
+                    _handle.destroy();
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Lookup(void)
+        {
+            if (_handle)
+                _handle.destroy();
+        }
+
+        bool Done(void) const { return _handle.done(); }
+        void Resume(void) { _handle.resume(); }
+        const Bid *Result(void) const { return _handle.promise().bid; }
+
+      private:
+        explicit Lookup(std::coroutine_handle<promise_type> handle)
+          : _handle(handle)
+        {
+        }
+
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    /*
+    ** co_await Prefetch{ node } : start fetching the node and let the other
+    ** lookups run until it is there
+    */
+    struct Prefetch
+    {
+        const void *address;
+
+        bool await_ready(void) const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept
+        {
+            __builtin_prefetch(address);
+        }
+        void await_resume(void) const noexcept {}
+    };
+
+    /*
+    ** Look up every id, width lookups at a time started by start(id) : a
+    ** finished one hands its bid over and its place to the next id
+    */
+    template<typename Start>
+    void run(std::span<const unsigned int> bidIds, std::span<const Bid *> bids,
+             std::size_t width, Start start)
+    {
+        std::vector<Lookup> lookups;
+        // the index of the id of each lookup
+        std::vector<std::size_t> ids;
+        std::size_t next = 0;
+
+        lookups.reserve(width);
+        ids.reserve(width);
+        for (; next < bidIds.size() && lookups.size() < width; next++)
+        {
+            lookups.push_back(start(bidIds[next]));
+            ids.push_back(next);
+        }
+
+        while (!lookups.empty())
+        {
+            for (std::size_t i = 0; i < lookups.size(); )
+            {
+                if (!lookups[i].Done())
+                    lookups[i].Resume();
+                if (!lookups[i].Done())
+                {
+                    i++;
+                    continue;
+                }
+
+                bids[ids[i]] = lookups[i].Result();
+                if (next < bidIds.size())
+                {
+                    lookups[i] = start(bidIds[next]);
+                    ids[i] = next++;
+                    i++;
+                }
+                else
+                {
+                    // the last one in flight takes its place
+                    lookups[i] = std::move(lookups.back());
+                    ids[i] = ids.back();
+                    lookups.pop_back();
+                    ids.pop_back();
+                }
+            }
+        }
+    }
+}
+
+#endif /*!_INTERLEAVE_HPP_*/
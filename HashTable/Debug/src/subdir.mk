@@ -4,15 +4,30 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/Bid.cpp \
+../src/BidSnapshot.cpp \
 ../src/CSVparser.cpp \
+../src/ConcurrentHashTable.cpp \
+../src/EpochReclaimer.cpp \
+../src/FlatHashTable.cpp \
 ../src/HashTable.cpp 
 
 OBJS += \
+./src/Bid.o \
+./src/BidSnapshot.o \
 ./src/CSVparser.o \
+./src/ConcurrentHashTable.o \
+./src/EpochReclaimer.o \
+./src/FlatHashTable.o \
 ./src/HashTable.o 
 
 CPP_DEPS += \
+./src/Bid.d \
+./src/BidSnapshot.d \
 ./src/CSVparser.d \
+./src/ConcurrentHashTable.d \
+./src/EpochReclaimer.d \
+./src/FlatHashTable.d \
 ./src/HashTable.d 
 
 
@@ -20,7 +35,7 @@ CPP_DEPS += \
 src/%.o: ../src/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -std=c++20 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
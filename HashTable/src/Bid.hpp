@@ -0,0 +1,53 @@
+#ifndef     _BID_HPP_
+# define    _BID_HPP_
+
+# include <cstdint>
+# include <string_view>
+
+# include "CSVparser.hpp"
+
+/*
+** A bid as every container keeps it : 24 bytes and no allocation. The
+** auction id is a number, the amount a whole number of cents, and the
+** title and fund are codes of strings stored once in the shared pools.
+** An id of 0 is no bid, what a failed search returns.
+*/
+struct Bid
+{
+    uint32_t bidId; // unique identifier
+    uint32_t title; // code of the title in Bid::titles
+    uint32_t fund; // code of the fund name in Bid::funds
+    int64_t amount; // in cents
+
+    Bid(void);
+    Bid(std::string_view bidId, std::string_view title,
+        std::string_view fund, double amount);
+    Bid(uint32_t bidId, std::string_view title,
+        std::string_view fund, int64_t amount);
+
+    bool empty(void) const;
+    const std::string &getTitle(void) const;
+    const std::string &getFund(void) const;
+    double getAmount(void) const;
+
+    static uint32_t parseId(std::string_view);
+
+    static csv::Dictionary titles;
+    static csv::Dictionary funds;
+};
+
+/*
+** The columns a bid is decoded from, the positions the original loaders
+** read (file[i][1], [0], [8] and [4]). They are those of the Dec 2016
+** export the programs load by default, where column 8 is the Fund. The
+** full monthly export has Auction Fee Total there and the Fund at 19, so
+** a bid read from it carries the fee total as its fund : one pool entry
+** per distinct value, interning saves nothing on that file.
+*/
+typedef csv::Schema<Bid,
+                    csv::Parsed<1, &Bid::bidId, &Bid::parseId>,
+                    csv::Code<0, &Bid::title, Bid::titles>,
+                    csv::Code<8, &Bid::fund, Bid::funds>,
+                    csv::Currency<4, &Bid::amount> > BidSchema;
+
+#endif /*!_BID_HPP_*/
@@ -0,0 +1,182 @@
+#ifndef     _BIDHASH_HPP_
+# define    _BIDHASH_HPP_
+
+# include <bit>
+# include <cstddef>
+# include <cstdint>
+# include <cstring>
+# include <limits>
+
+/*
+** Hashing of bid ids for the hash tables. hashBytes follows wyhash (final
+** version 4, public domain, https://github.com/wangyi-fudan/wyhash) : a
+** few 64x64->128 bit multiplies for a short key, well spread over all
+** 64 bits whatever the key looks like.
+**
+** A hash policy tells a table how many buckets to have and which of them
+** a key goes to :
+**
+**   static unsigned int buckets(unsigned int count)
+**       the number of buckets to use for at least count of them, or
+**       the most the policy can have
+**   static unsigned int bucket(unsigned int key, unsigned int buckets)
+**       the bucket of key, below buckets
+*/
+namespace bidhash
+{
+    namespace detail
+    {
+        inline uint64_t mix(uint64_t a, uint64_t b)
+        {
+            __uint128_t r = static_cast<__uint128_t>(a) * b;
+            return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+        }
+
+        inline uint64_t read8(const uint8_t *p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            return v;
+        }
+
+        inline uint64_t read4(const uint8_t *p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+
+        inline uint64_t read3(const uint8_t *p, std::size_t k)
+        {
+            return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+        }
+    }
+
+    inline uint64_t hashBytes(const void *key, std::size_t len, uint64_t seed = 0)
+    {
+        static const uint64_t S0 = 0xa0761d6478bd642fULL;
+        static const uint64_t S1 = 0xe7037ed1a0b428dbULL;
+        static const uint64_t S2 = 0x8ebc6af09c88c6e3ULL;
+        static const uint64_t S3 = 0x589965cc75374cc3ULL;
+        const uint8_t *p = static_cast<const uint8_t *>(key);
+        uint64_t a;
+        uint64_t b;
+
+        seed ^= detail::mix(seed ^ S0, S1);
+        if (len <= 16)
+        {
+            if (len >= 4)
+            {
+                std::size_t shift = (len >> 3) << 2;
+                a = (detail::read4(p) << 32) | detail::read4(p + shift);
+                b = (detail::read4(p + len - 4) << 32) | detail::read4(p + len - 4 - shift);
+            }
+            else if (len > 0)
+            {
+                a = detail::read3(p, len);
+                b = 0;
+            }
+            else
+                a = b = 0;
+        }
+        else
+        {
+            std::size_t i = len;
+            if (i > 48)
+            {
+                uint64_t see1 = seed;
+                uint64_t see2 = seed;
+                do
+                {
+                    seed = detail::mix(detail::read8(p) ^ S1, detail::read8(p + 8) ^ seed);
+                    see1 = detail::mix(detail::read8(p + 16) ^ S2, detail::read8(p + 24) ^ see1);
+                    see2 = detail::mix(detail::read8(p + 32) ^ S3, detail::read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16)
+            {
+                seed = detail::mix(detail::read8(p) ^ S1, detail::read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = detail::read8(p + i - 16);
+            b = detail::read8(p + i - 8);
+        }
+
+        a ^= S1;
+        b ^= seed;
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        a = static_cast<uint64_t>(r);
+        b = static_cast<uint64_t>(r >> 64);
+        return detail::mix(a ^ S0 ^ len, b ^ S1);
+    }
+
+    inline uint64_t hashId(unsigned int key)
+    {
+        return hashBytes(&key, sizeof(key));
+    }
+
+    /*
+    ** The id itself modulo an odd number of buckets, as the table always
+    ** did : consecutive ids go to consecutive buckets
+    */
+    struct Modulo
+    {
+        static const char *name(void) { return "modulo"; }
+
+        static unsigned int buckets(unsigned int count)
+        {
+            return count | 1;
+        }
+
+        static unsigned int bucket(unsigned int key, unsigned int buckets)
+        {
+            return key % buckets;
+        }
+    };
+
+    /*
+    ** The low bits of the hash, a power of two number of buckets : past
+    ** the largest one an unsigned int holds, that one
+    */
+    struct Mask
+    {
+        static const char *name(void) { return "wyhash & mask"; }
+
+        static unsigned int buckets(unsigned int count)
+        {
+            const unsigned int largest = 1u << (std::numeric_limits<unsigned int>::digits - 1);
+
+            return (count > largest) ? largest : std::bit_ceil(count);
+        }
+
+        static unsigned int bucket(unsigned int key, unsigned int buckets)
+        {
+            return hashId(key) & (buckets - 1);
+        }
+    };
+
+    /*
+    ** The high 32 bits of the hash scaled to any number of buckets with a
+    ** multiply and a shift (Lemire's fastrange), no division
+    */
+    struct FastRange
+    {
+        static const char *name(void) { return "wyhash fastrange"; }
+
+        static unsigned int buckets(unsigned int count)
+        {
+            return count;
+        }
+
+        static unsigned int bucket(unsigned int key, unsigned int buckets)
+        {
+            return ((hashId(key) >> 32) * buckets) >> 32;
+        }
+    };
+}
+
+#endif /*!_BIDHASH_HPP_*/
@@ -0,0 +1,180 @@
+#include "BidHash.hpp"
+#include "ConcurrentHashTable.hpp"
+
+ConcurrentHashTable::Buckets::Buckets(std::size_t count)
+  : count(count), heads(new std::atomic<Node *>[count])
+{
+    for (std::size_t i = 0; i < count; i++)
+        heads[i].store(nullptr, std::memory_order_relaxed);
+}
+
+/*
+** The chains go with their buckets : they are retired together, or
+** with the table
+*/
+ConcurrentHashTable::Buckets::~Buckets(void)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        Node *node = heads[i].load(std::memory_order_relaxed);
+        while (node != nullptr)
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+    delete[] heads;
+}
+
+ConcurrentHashTable::ConcurrentHashTable(void)
+  : _buckets(new Buckets(bucketsFor(0))), _size(0)
+{
+}
+
+/*
+** What is still retired is freed by the reclaimer, after the buckets
+*/
+ConcurrentHashTable::~ConcurrentHashTable(void)
+{
+    delete _buckets.load();
+}
+
+uint64_t ConcurrentHashTable::hash(unsigned int bidId)
+{
+    return bidhash::hashId(bidId);
+}
+
+std::size_t ConcurrentHashTable::bucketsFor(std::size_t count)
+{
+    std::size_t buckets = STRIPES;
+
+    while (buckets * MAX_LOAD < count)
+        buckets <<= 1;
+    return buckets;
+}
+
+/*
+** New bids go to the head of their bucket : the node is complete before
+** the release store that links it, which readers load with acquire
+*/
+void ConcurrentHashTable::Insert(const Bid &bid)
+{
+    uint64_t h = hash(bid.bidId);
+    std::size_t count;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[h % STRIPES].lock);
+        // no growth while a stripe is held, the buckets stay the same
+        Buckets *buckets = _buckets.load(std::memory_order_relaxed);
+        std::atomic<Node *> &head = buckets->heads[h & (buckets->count - 1)];
+
+        Node *node = new Node{ bid, { head.load(std::memory_order_relaxed) } };
+        head.store(node, std::memory_order_release);
+        count = buckets->count;
+    }
+
+    if (_size.fetch_add(1) + 1 > count * MAX_LOAD)
+        grow(count * 2);
+}
+
+/*
+** The node is unlinked by pointing the link to it at the node after it.
+** Readers already on it still go on from there : its own link is left
+** as it was until it is freed.
+*/
+bool ConcurrentHashTable::Remove(unsigned int bidId)
+{
+    uint64_t h = hash(bidId);
+    Node *node;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[h % STRIPES].lock);
+        Buckets *buckets = _buckets.load(std::memory_order_relaxed);
+        std::atomic<Node *> *link = &buckets->heads[h & (buckets->count - 1)];
+
+        for (node = link->load(std::memory_order_relaxed); node != nullptr;
+             node = link->load(std::memory_order_relaxed))
+        {
+            if (node->bid.bidId == bidId)
+                break;
+            link = &node->next;
+        }
+        if (node == nullptr)
+            return false;
+        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    _size.fetch_sub(1);
+    _reclaimer.Retire(node);
+    return true;
+}
+
+bool ConcurrentHashTable::Remove(std::string_view bidId)
+{
+    return Remove(Bid::parseId(bidId));
+}
+
+void ConcurrentHashTable::Reserve(std::size_t count)
+{
+    grow(bucketsFor(count));
+}
+
+/*
+** Take every stripe, in order so two growths cannot deadlock, and copy
+** the chains to a larger set of buckets. Whoever got there first may
+** already have grown the table.
+*/
+void ConcurrentHashTable::grow(std::size_t count)
+{
+    std::unique_lock<std::mutex> locks[STRIPES];
+    for (std::size_t i = 0; i < STRIPES; i++)
+        locks[i] = std::unique_lock<std::mutex>(_stripes[i].lock);
+
+    Buckets *old = _buckets.load(std::memory_order_relaxed);
+    if (old->count >= count)
+        return;
+
+    Buckets *buckets = new Buckets(count);
+    for (std::size_t i = 0; i < old->count; i++)
+    {
+        for (Node *node = old->heads[i].load(std::memory_order_relaxed); node != nullptr;
+             node = node->next.load(std::memory_order_relaxed))
+        {
+            std::atomic<Node *> &head = buckets->heads[hash(node->bid.bidId) & (count - 1)];
+            head.store(new Node{ node->bid, { head.load(std::memory_order_relaxed) } },
+                       std::memory_order_relaxed);
+        }
+    }
+    _buckets.store(buckets, std::memory_order_release);
+
+    for (std::unique_lock<std::mutex> &lock : locks)
+        lock.unlock();
+    _reclaimer.Retire(old);
+}
+
+bool ConcurrentHashTable::Search(unsigned int bidId, Bid &bid) const
+{
+    uint64_t h = hash(bidId);
+    EpochReclaimer::Guard guard(_reclaimer);
+    const Buckets *buckets = _buckets.load(std::memory_order_acquire);
+
+    for (const Node *node = buckets->heads[h & (buckets->count - 1)].load(std::memory_order_acquire);
+         node != nullptr; node = node->next.load(std::memory_order_acquire))
+    {
+        if (node->bid.bidId == bidId)
+        {
+            bid = node->bid;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConcurrentHashTable::Search(std::string_view bidId, Bid &bid) const
+{
+    return Search(Bid::parseId(bidId), bid);
+}
+
+std::size_t ConcurrentHashTable::Size(void) const
+{
+    return _size.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,101 @@
+#ifndef     _CONCURRENTHASHTABLE_HPP_
+# define    _CONCURRENTHASHTABLE_HPP_
+
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+# include <mutex>
+# include <string_view>
+# include <utility>
+
+# include "Bid.hpp"
+# include "EpochReclaimer.hpp"
+
+/*
+** Chained hash table of bids for many threads searching it while others
+** insert and remove. Readers take no lock : they pin an epoch and follow
+** the chains, whose links writers only ever replace with one atomic
+** store, so a reader sees a chain either before or after each change.
+** Writers lock one of STRIPES mutexes, picked by the low bits of the
+** hash that also pick the bucket, so writes to different stripes go on
+** in parallel. A removed node is retired to the EpochReclaimer, freed
+** once no reader can still be on it.
+**
+** Past MAX_LOAD bids per bucket the table doubles. Growing takes every
+** stripe and copies the nodes to new buckets that readers switch to with
+** one pointer, the old ones being retired as a whole : readers still on
+** them find the bids as they were. Reserve sizes the table ahead of a
+** bulk load instead.
+**
+** Search copies the bid out, its node may be freed as soon as the epoch
+** is no longer pinned. The title and fund pools of Bid are not locked :
+** only one thread may build new bids from text at a time.
+*/
+class ConcurrentHashTable
+{
+
+  public:
+    static const std::size_t STRIPES = 64;
+    static const std::size_t MAX_LOAD = 1;
+
+    ConcurrentHashTable(void);
+    ~ConcurrentHashTable(void);
+    ConcurrentHashTable(const ConcurrentHashTable &) = delete;
+    ConcurrentHashTable &operator=(const ConcurrentHashTable &) = delete;
+
+  public:
+    void Insert(const Bid &bid);
+    template<typename... Args>
+    void Emplace(Args&&... args);
+    bool Remove(unsigned int bidId);
+    bool Remove(std::string_view bidId);
+    void Reserve(std::size_t count);
+    bool Search(unsigned int bidId, Bid &bid) const;
+    bool Search(std::string_view bidId, Bid &bid) const;
+    std::size_t Size(void) const;
+
+  private:
+    struct Node
+    {
+        Bid bid;
+        std::atomic<Node *> next;
+    };
+
+    // a power of two number of buckets, never less than STRIPES, so the
+    // bits of a bucket's stripe are bits of its index
+    struct Buckets
+    {
+        explicit Buckets(std::size_t count);
+        ~Buckets(void);
+
+        std::size_t count;
+        std::atomic<Node *> *heads;
+    };
+
+    // a mutex to a cache line, the stripes do not share one
+    struct alignas(64) Stripe
+    {
+        std::mutex lock;
+    };
+
+    static uint64_t hash(unsigned int bidId);
+    static std::size_t bucketsFor(std::size_t count);
+    void grow(std::size_t count);
+
+  private:
+    std::atomic<Buckets *> _buckets;
+    std::atomic<std::size_t> _size;
+    mutable Stripe _stripes[STRIPES];
+    mutable EpochReclaimer _reclaimer;
+};
+
+/*
+** The bid is built first, its id telling where it goes
+*/
+template<typename... Args>
+void ConcurrentHashTable::Emplace(Args&&... args)
+{
+    Insert(Bid(std::forward<Args>(args)...));
+}
+
+#endif /*!_CONCURRENTHASHTABLE_HPP_*/
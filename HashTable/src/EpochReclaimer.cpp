@@ -0,0 +1,124 @@
+#include <stdexcept>
+#include "EpochReclaimer.hpp"
+
+namespace {
+
+  // which of the MAX_THREADS indexes are taken by a live thread
+  std::atomic<bool> taken[EpochReclaimer::MAX_THREADS];
+
+  /*
+  ** The index of a thread, the same in every reclaimer, given back when
+  ** the thread ends
+  */
+  class ThreadIndex
+  {
+
+    public:
+      ThreadIndex(void)
+      {
+          for (_index = 0; _index < EpochReclaimer::MAX_THREADS; _index++)
+          {
+              bool expected = false;
+              if (taken[_index].compare_exchange_strong(expected, true))
+                  return;
+          }
+          throw std::runtime_error("EpochReclaimer: too many threads");
+      }
+
+      ~ThreadIndex(void)
+      {
+          taken[_index].store(false);
+      }
+
+      std::size_t _index;
+  };
+
+}
+
+EpochReclaimer::EpochReclaimer(void)
+  : _epoch(0)
+{
+    for (Slot &slot : _slots)
+        slot.epoch.store(QUIESCENT, std::memory_order_relaxed);
+}
+
+/*
+** No thread may be pinned any more, everything still retired is freed
+*/
+EpochReclaimer::~EpochReclaimer(void)
+{
+    for (std::vector<Retired> &retired : _retired)
+        for (const Retired &r : retired)
+            r.release(r.object);
+}
+
+std::size_t EpochReclaimer::threadIndex(void)
+{
+    static thread_local ThreadIndex index;
+
+    return index._index;
+}
+
+/*
+** The epoch is read again once published : had it moved on in between,
+** a thread advancing it may not have seen this one, which then pins the
+** new epoch instead. seq_cst orders the store before the reads of the
+** structure that follow.
+*/
+EpochReclaimer::Guard::Guard(const EpochReclaimer &reclaimer)
+  : _slot(reclaimer._slots[threadIndex()].epoch)
+{
+    uint64_t epoch = reclaimer._epoch.load();
+
+    for (;;)
+    {
+        _slot.store(epoch);
+        uint64_t now = reclaimer._epoch.load();
+        if (now == epoch)
+            break;
+        epoch = now;
+    }
+}
+
+EpochReclaimer::Guard::~Guard(void)
+{
+    _slot.store(QUIESCENT, std::memory_order_release);
+}
+
+/*
+** Whether every pinned thread has seen an epoch
+*/
+bool EpochReclaimer::advance(uint64_t epoch) const
+{
+    for (const Slot &slot : _slots)
+    {
+        uint64_t pinned = slot.epoch.load();
+        if (pinned != QUIESCENT && pinned != epoch)
+            return false;
+    }
+    return true;
+}
+
+/*
+** The object is kept with those of the current epoch. When the epoch can
+** move on, to e + 1, what was retired during e - 2 is freed : it was
+** unlinked before any thread now pinned got in.
+*/
+void EpochReclaimer::Retire(void *object, void (*release)(void *))
+{
+    std::vector<Retired> freed;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        uint64_t epoch = _epoch.load();
+
+        _retired[epoch % 3].push_back(Retired{ object, release });
+        if (!advance(epoch))
+            return;
+        _epoch.store(epoch + 1);
+        freed.swap(_retired[(epoch + 1) % 3]);
+    }
+
+    // freed out of the lock, the other writers need not wait for it
+    for (const Retired &r : freed)
+        r.release(r.object);
+}
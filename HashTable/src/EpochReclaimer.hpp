@@ -0,0 +1,86 @@
+#ifndef     _EPOCHRECLAIMER_HPP_
+# define    _EPOCHRECLAIMER_HPP_
+
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+# include <mutex>
+# include <vector>
+
+/*
+** Epoch based reclamation, for memory unlinked by a writer while readers
+** may still be walking it. A reader pins the current epoch for as long
+** as it holds pointers into the structure. A writer hands what it has
+** unlinked to Retire, which frees it two epochs later. The epoch only
+** moves on once every pinned thread has seen it, so by then no reader
+** can have come across the memory.
+**
+** Pinning is a store to a slot of the thread's own and a load, with
+** no lock. Retire takes a lock, writers being expected to hold one
+** anyway. At most MAX_THREADS threads may use a reclaimer at the same
+** time, and the guards of a thread on one reclaimer do not nest.
+*/
+class EpochReclaimer
+{
+
+  public:
+    static const std::size_t MAX_THREADS = 128;
+
+    // pins the epoch for its lifetime
+    class Guard
+    {
+
+      public:
+        explicit Guard(const EpochReclaimer &reclaimer);
+        ~Guard(void);
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+      private:
+        std::atomic<uint64_t> &_slot;
+    };
+
+    EpochReclaimer(void);
+    ~EpochReclaimer(void);
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+  public:
+    void Retire(void *object, void (*release)(void *));
+
+    template<typename T>
+    void Retire(T *object);
+
+  private:
+    struct Retired
+    {
+        void *object;
+        void (*release)(void *);
+    };
+
+    // a slot of its own per thread, on its own cache line
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch;
+    };
+
+    static const uint64_t QUIESCENT = UINT64_MAX;
+
+    static std::size_t threadIndex(void);
+    bool advance(uint64_t epoch) const;
+
+  private:
+    mutable Slot _slots[MAX_THREADS];
+    std::atomic<uint64_t> _epoch;
+    std::mutex _lock;
+    // what was retired in each of the last three epochs
+    std::vector<Retired> _retired[3];
+};
+
+template<typename T>
+void EpochReclaimer::Retire(T *object)
+{
+    Retire(object, [](void *p) { delete static_cast<T *>(p); });
+}
+
+#endif /*!_EPOCHRECLAIMER_HPP_*/
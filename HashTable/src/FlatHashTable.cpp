@@ -0,0 +1,358 @@
+#include <iostream>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+#include "FlatHashTable.hpp"
+
+/*
+** Control bytes : a full slot holds the low 7 bits of its hash, the two
+** other states have the high bit set
+*/
+static const int8_t EMPTY = -128;
+static const int8_t DELETED = -2;
+
+/*
+** The 16 control bytes of a group, matched all at once. Each match is a
+** bit mask of the slots of the group, bit i for slot i.
+*/
+namespace {
+
+  class Group
+  {
+
+    public:
+      explicit Group(const int8_t *ctrl)
+#if defined(__SSE2__)
+        : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)))
+#else
+        : _ctrl(ctrl)
+#endif
+      {
+      }
+
+#if defined(__SSE2__)
+      uint32_t match(int8_t h2) const
+      {
+          return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl));
+      }
+
+      // empty or deleted, the only bytes with the high bit set
+      uint32_t matchAvailable(void) const
+      {
+          return _mm_movemask_epi8(_ctrl);
+      }
+#else
+      uint32_t match(int8_t h2) const
+      {
+          uint32_t mask = 0;
+          for (std::size_t i = 0; i < FlatHashTable::GROUP; i++)
+              if (_ctrl[i] == h2)
+                  mask |= 1u << i;
+          return mask;
+      }
+
+      uint32_t matchAvailable(void) const
+      {
+          uint32_t mask = 0;
+          for (std::size_t i = 0; i < FlatHashTable::GROUP; i++)
+              if (_ctrl[i] < 0)
+                  mask |= 1u << i;
+          return mask;
+      }
+#endif
+
+      uint32_t matchEmpty(void) const
+      {
+          return match(EMPTY);
+      }
+
+    private:
+#if defined(__SSE2__)
+      __m128i _ctrl;
+#else
+      const int8_t *_ctrl;
+#endif
+  };
+
+}
+
+FlatHashTable::FlatHashTable(void)
+  : _ctrl(GROUP, EMPTY), _slots(GROUP), _size(0), _growthLeft(GROUP - GROUP / 8),
+    _tombstones(0), _migrated(0)
+{
+}
+
+/*
+** Ids are consecutive auction numbers, the finalizer of MurmurHash3
+** spreads them over all 64 bits : the low 7 go to the control byte, the
+** others pick the first group to probe.
+*/
+uint64_t FlatHashTable::hash(unsigned int bidId)
+{
+    uint64_t h = bidId;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/*
+** Slot of the first bid with that id along its probe sequence, or the
+** size of the arrays if there is none. Groups are visited 1, 2, 3...
+** groups apart, which reaches every group of a power of two count, and a
+** group with an empty slot ends the search : the id would have been put
+** there.
+*/
+std::size_t FlatHashTable::find(const std::vector<int8_t> &ctrl,
+                                const std::vector<Bid> &slots, unsigned int bidId)
+{
+    uint64_t h = hash(bidId);
+    int8_t h2 = h & 0x7F;
+    std::size_t mask = ctrl.size() / GROUP - 1;
+    std::size_t group = (h >> 7) & mask;
+
+    for (std::size_t step = 1; ; step++)
+    {
+        std::size_t first = group * GROUP;
+        Group bytes(&ctrl[first]);
+
+        for (uint32_t match = bytes.match(h2); match != 0; match &= match - 1)
+        {
+            std::size_t slot = first + __builtin_ctz(match);
+            if (slots[slot].bidId == bidId)
+                return slot;
+        }
+        if (bytes.matchEmpty() != 0)
+            return ctrl.size();
+        group = (group + step) & mask;
+    }
+}
+
+/*
+** First empty or deleted slot along the probe sequence of a hash
+*/
+std::size_t FlatHashTable::place(uint64_t h) const
+{
+    std::size_t mask = _ctrl.size() / GROUP - 1;
+    std::size_t group = (h >> 7) & mask;
+
+    for (std::size_t step = 1; ; step++)
+    {
+        uint32_t available = Group(&_ctrl[group * GROUP]).matchAvailable();
+        if (available != 0)
+            return group * GROUP + __builtin_ctz(available);
+        group = (group + step) & mask;
+    }
+}
+
+void FlatHashTable::store(std::size_t slot, uint64_t h, const Bid &bid)
+{
+    if (_ctrl[slot] == DELETED)
+        _tombstones--;
+    _ctrl[slot] = h & 0x7F;
+    _slots[slot] = bid;
+}
+
+/*
+** A slot whose group still has an empty slot is never probed past, it
+** can be emptied. Otherwise it becomes a tombstone, so the probes going
+** through its group carry on to the next. Tells which it was.
+*/
+bool FlatHashTable::erase(std::vector<int8_t> &ctrl, std::vector<Bid> &slots, std::size_t slot)
+{
+    bool tombstone = Group(&ctrl[slot / GROUP * GROUP]).matchEmpty() == 0;
+
+    ctrl[slot] = tombstone ? DELETED : EMPTY;
+    slots[slot] = Bid();
+    return tombstone;
+}
+
+/*
+** Slots for count bids with room for as many more, a power of two
+*/
+std::size_t FlatHashTable::capacityFor(std::size_t count)
+{
+    std::size_t capacity = GROUP;
+
+    while (count * 2 > capacity - capacity / 8)
+        capacity <<= 1;
+    return capacity;
+}
+
+/*
+** Start moving the bids to new arrays of the given number of slots,
+** which leaves the tombstones behind. Room is kept in the new arrays for
+** every bid still to be moved.
+*/
+void FlatHashTable::rebuild(std::size_t capacity)
+{
+    // a rebuild started before this one is finished first
+    migrate(_oldCtrl.size() / GROUP);
+
+    _oldCtrl.swap(_ctrl);
+    _oldSlots.swap(_slots);
+    _migrated = 0;
+
+    _ctrl.assign(capacity, EMPTY);
+    _slots.assign(capacity, Bid());
+    _growthLeft = capacity - capacity / 8 - _size;
+    _tombstones = 0;
+}
+
+/*
+** Move the bids of some groups of the old arrays. Their slots there are
+** marked deleted, so the probes for the bids not moved yet still reach
+** them.
+*/
+void FlatHashTable::migrate(std::size_t groups)
+{
+    if (_oldCtrl.empty())
+        return;
+
+    std::size_t count = _oldCtrl.size() / GROUP;
+    for (; groups > 0 && _migrated < count; groups--, _migrated++)
+    {
+        std::size_t first = _migrated * GROUP;
+        for (std::size_t i = first; i < first + GROUP; i++)
+        {
+            if (_oldCtrl[i] < 0)
+                continue;
+            uint64_t h = hash(_oldSlots[i].bidId);
+            store(place(h), h, _oldSlots[i]);
+            _oldCtrl[i] = DELETED;
+        }
+    }
+
+    if (_migrated == count)
+    {
+        std::vector<int8_t>().swap(_oldCtrl);
+        std::vector<Bid>().swap(_oldSlots);
+        _migrated = 0;
+    }
+}
+
+const Bid &FlatHashTable::Insert(const Bid &bid)
+{
+    migrate(MIGRATE_STEP);
+
+    uint64_t h = hash(bid.bidId);
+    std::size_t slot = place(h);
+
+    // taking an empty slot brings the table closer to full, past 7/8
+    // it is rebuilt : larger, or only without its tombstones when they
+    // are what fills it
+    if (_ctrl[slot] == EMPTY && _growthLeft == 0)
+    {
+        rebuild(capacityFor(_size));
+        slot = place(h);
+    }
+    if (_ctrl[slot] == EMPTY)
+        _growthLeft--;
+
+    store(slot, h, bid);
+    _size++;
+    return _slots[slot];
+}
+
+void FlatHashTable::printAll(const std::vector<int8_t> &ctrl, const std::vector<Bid> &slots)
+{
+    for (std::size_t i = 0; i < slots.size(); i++)
+    {
+        if (ctrl[i] < 0)
+            continue;
+        const Bid &bid = slots[i];
+        std::cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount()
+                  << " | " << bid.getFund() << std::endl;
+    }
+}
+
+void FlatHashTable::PrintAll(void) const
+{
+    printAll(_oldCtrl, _oldSlots);
+    printAll(_ctrl, _slots);
+}
+
+/*
+** A bid not moved yet by a rebuild is removed from the old arrays. Once
+** a quarter of the slots are tombstones, lookups have that many more
+** slots to go through : the table is rebuilt without them. It is rebuilt
+** smaller too when it is down to a sixteenth full.
+*/
+void FlatHashTable::Remove(unsigned int bidId)
+{
+    migrate(MIGRATE_STEP);
+
+    if (!_oldCtrl.empty())
+    {
+        std::size_t slot = find(_oldCtrl, _oldSlots, bidId);
+        if (slot != _oldCtrl.size())
+        {
+            erase(_oldCtrl, _oldSlots, slot);
+            _size--;
+            return;
+        }
+    }
+
+    std::size_t slot = find(_ctrl, _slots, bidId);
+    if (slot == _ctrl.size())
+        return;
+
+    if (erase(_ctrl, _slots, slot))
+        _tombstones++;
+    else
+        _growthLeft++;
+    _size--;
+
+    if (!_oldCtrl.empty())
+        return;
+    if (_tombstones >= _ctrl.size() / 4
+        || (_ctrl.size() > GROUP && _size < _ctrl.size() / 16))
+        rebuild(capacityFor(_size));
+}
+
+void FlatHashTable::Remove(std::string_view bidId)
+{
+    Remove(Bid::parseId(bidId));
+}
+
+/*
+** The old arrays first while a rebuild is under way, they hold the bids
+** that were there before it
+*/
+const Bid *FlatHashTable::Search(unsigned int bidId) const
+{
+    if (!_oldCtrl.empty())
+    {
+        std::size_t slot = find(_oldCtrl, _oldSlots, bidId);
+        if (slot != _oldCtrl.size())
+            return &_oldSlots[slot];
+    }
+
+    std::size_t slot = find(_ctrl, _slots, bidId);
+    if (slot == _ctrl.size())
+        return nullptr;
+    return &_slots[slot];
+}
+
+const Bid *FlatHashTable::Search(std::string_view bidId) const
+{
+    return Search(Bid::parseId(bidId));
+}
+
+std::size_t FlatHashTable::Size(void) const
+{
+    return _size;
+}
+
+std::size_t FlatHashTable::Capacity(void) const
+{
+    return _ctrl.size();
+}
+
+std::size_t FlatHashTable::Tombstones(void) const
+{
+    return _tombstones;
+}
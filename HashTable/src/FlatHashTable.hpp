@@ -0,0 +1,92 @@
+#ifndef     _FLATHASHTABLE_HPP_
+# define    _FLATHASHTABLE_HPP_
+
+# include <cstddef>
+# include <cstdint>
+# include <string_view>
+# include <utility>
+# include <vector>
+
+# include "Bid.hpp"
+
+/*
+** Open addressing hash table of bids, in the manner of SwissTable : the
+** bids are stored inline in one flat array of slots, alongside an array
+** of one control byte per slot. A control byte tells whether its slot is
+** empty, deleted or full, and for a full slot holds 7 bits of the hash
+** of its id. Slots are probed a group of 16 at a time, one SIMD compare
+** of the group's control bytes picking the few slots whose id may match,
+** so a lookup mostly reads 16 control bytes and one slot.
+**
+** A removed bid leaves a tombstone only where a probe may have to go
+** past its slot. The table is rebuilt, larger or of the same size, when
+** an insert would make it more than 7/8 full tombstones included, once
+** a quarter of its slots are tombstones, and smaller when removes leave
+** it a sixteenth full. A rebuild is spread over
+** the next inserts and removes, which each move MIGRATE_STEP groups of
+** the old arrays to the new ones, and lookups read both until it is
+** over : no single call pays for the whole table.
+**
+** Like the chained HashTable an id may be inserted more than once,
+** Search then returns one of its bids.
+*/
+class FlatHashTable
+{
+
+  public:
+    static const std::size_t GROUP = 16;
+    static const std::size_t MIGRATE_STEP = 2;
+
+    FlatHashTable(void);
+    FlatHashTable(const FlatHashTable &) = delete;
+    FlatHashTable &operator=(const FlatHashTable &) = delete;
+
+  public:
+    const Bid &Insert(const Bid &bid);
+    template<typename... Args>
+    const Bid &Emplace(Args&&... args);
+    void PrintAll(void) const;
+    void Remove(unsigned int bidId);
+    void Remove(std::string_view bidId);
+    const Bid *Search(unsigned int bidId) const;
+    const Bid *Search(std::string_view bidId) const;
+    std::size_t Size(void) const;
+    std::size_t Capacity(void) const;
+    std::size_t Tombstones(void) const;
+
+  private:
+    static uint64_t hash(unsigned int bidId);
+    static std::size_t find(const std::vector<int8_t> &ctrl, const std::vector<Bid> &slots,
+                            unsigned int bidId);
+    static bool erase(std::vector<int8_t> &ctrl, std::vector<Bid> &slots, std::size_t slot);
+    static void printAll(const std::vector<int8_t> &ctrl, const std::vector<Bid> &slots);
+    static std::size_t capacityFor(std::size_t count);
+    std::size_t place(uint64_t hash) const;
+    void store(std::size_t slot, uint64_t hash, const Bid &bid);
+    void rebuild(std::size_t capacity);
+    void migrate(std::size_t groups);
+
+  private:
+    std::vector<int8_t> _ctrl;
+    std::vector<Bid> _slots;
+    std::size_t _size;
+    std::size_t _growthLeft;
+    std::size_t _tombstones;
+
+    // while the table is rebuilt, the arrays it had before and how many
+    // of their groups have been moved
+    std::vector<int8_t> _oldCtrl;
+    std::vector<Bid> _oldSlots;
+    std::size_t _migrated;
+};
+
+/*
+** The bid is built first, its id telling where it goes
+*/
+template<typename... Args>
+const Bid &FlatHashTable::Emplace(Args&&... args)
+{
+    return Insert(Bid(std::forward<Args>(args)...));
+}
+
+#endif /*!_FLATHASHTABLE_HPP_*/
@@ -9,12 +9,34 @@
 //============================================================================
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <cstdint>
 #include <iostream>
-#include <string> // atoi
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <time.h>
-
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Bid.hpp"
+#include "BidHash.hpp"
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
+#include "ConcurrentHashTable.hpp"
+#include "FlatHashTable.hpp"
+#include "Interleave.hpp"
+#include "NodePool.hpp"
 
 using namespace std;
 
@@ -24,19 +46,17 @@ using namespace std;
 
 const unsigned int DEFAULT_SIZE = 179;
 
-// forward declarations
-double strToDouble(string str, char ch);
+// the table grows once it holds more bids than this per bucket
+const unsigned int MAX_LOAD = 1;
 
-// define a structure to hold bid information
-struct Bid {
-    string bidId; // unique identifier
-    string title;
-    string fund;
-    double amount;
-    Bid() {
-        amount = 0.0;
-    }
-};
+// buckets moved to the grown table by every insert or remove
+const unsigned int REHASH_STEP = 4;
+
+// lookups of SearchBatch whose buckets are fetched from memory together
+const size_t SEARCH_BATCH = 16;
+
+// lookups of SearchInterleaved in flight at once
+const size_t INTERLEAVE_WIDTH = 16;
 
 //============================================================================
 // Hash Table class definition
@@ -45,7 +65,28 @@ struct Bid {
 /**
  * Define a class containing data members and methods to
  * implement a hash table with chaining.
+ *
+ * The table doubles when it holds more than MAX_LOAD bids per bucket.
+ * Its bids are not all moved at once : the old buckets are kept, and
+ * every insert or remove moves REHASH_STEP of them to the new table, so
+ * no single call pays for the whole rehash. Until the last one is moved,
+ * lookups read the old bucket of an id and then its new one.
+ *
+ * The bucket of an id is chosen by the Hash policy (see BidHash.hpp).
+ * By default it is the id modulo an odd number of buckets : auction ids
+ * are dense and increasing, and spread that way they collide less than
+ * hashed (menu option 8 reports both). Ids without that pattern are
+ * better served by bidhash::Mask or bidhash::FastRange.
+ *
+ * The first node of a bucket is in the vector, the ones chained after it
+ * come from a NodePool : a removed node is reused by the next insert, and
+ * they are all released at once with the table, or kept for the next
+ * bids by Clear.
+ *
+ * An id may be inserted more than once, Search then returns one of its
+ * bids.
  */
+template<typename Hash = bidhash::Modulo>
 class HashTable {
 
 private:
@@ -64,11 +105,11 @@ private:
 		};
 		// initialize second constructor that takes a bid
 		// will invoke the default constructor
-		Node(Bid aBid) : Node() {
+		Node(const Bid &aBid) : Node() {
 			bid = aBid;
 		};
 		// initialize third constructor with a bid and a key
-		Node(Bid aBid, unsigned aKey): Node(aBid){
+		Node(const Bid &aBid, unsigned aKey): Node(aBid){
 			key = aKey;
 		}
 	};
@@ -76,25 +117,58 @@ private:
 	// create a vector named nodes to hold the nodes
     vector<Node> nodes;
 
+    // while the table grows, the buckets it had before
+    vector<Node> oldNodes;
+
+    // the old buckets before this one have been moved to nodes
+    unsigned int migrated = 0;
+
     // create a variable to hold the hash table size - will allow us to change the size
     unsigned tableSize = DEFAULT_SIZE;
 
-    unsigned int hash(int key);
+    // number of bids in the table
+    unsigned int size = 0;
+
+    // the chained nodes of both the buckets and the old ones
+    NodePool<Node> pool;
+
+    unsigned int hash(unsigned int key, unsigned int buckets) const;
+    Node* place(vector<Node>& table, unsigned int key, const Bid& bid);
+    void grow(unsigned int buckets);
+    void rehash(unsigned int steps);
+    bool removeFrom(vector<Node>& table, unsigned int key, unsigned int bidId);
+    static const Bid* searchIn(const vector<Node>& table, unsigned int key, unsigned int bidId);
+    static void printAll(const vector<Node>& table, unsigned int first);
+    interleave::Lookup interleavedSearch(unsigned int bidId) const;
 
 public:
     HashTable();
     virtual ~HashTable();
-    void Insert(Bid bid);
+    void Clear();
+    const Bid &Insert(const Bid &bid);
+    template<typename... Args>
+    const Bid &Emplace(Args&&... args);
     void PrintAll();
-    void Remove(string bidId);
-    Bid Search(string bidId);
+    void Remove(unsigned int bidId);
+    void Remove(string_view bidId);
+    void Reserve(unsigned int count);
+    const Bid *Search(unsigned int bidId) const;
+    const Bid *Search(string_view bidId) const;
+    void SearchBatch(span<const unsigned int> bidIds, span<const Bid*> bids) const;
+    void SearchBatch(span<const string_view> bidIds, span<const Bid*> bids) const;
+    void SearchInterleaved(span<const unsigned int> bidIds, span<const Bid*> bids,
+            size_t width = INTERLEAVE_WIDTH) const;
+    unsigned int Size() const;
 };
 
 /**
  * Default constructor
  */
-HashTable::HashTable() {
+template<typename Hash>
+HashTable<Hash>::HashTable() {
     // Initialize the structures used to hold bids
+	// the policy may round the size, to a power of two say
+	tableSize = Hash::buckets(DEFAULT_SIZE);
 	//  call resize method of the vector class on the size of the table
 	nodes.resize(tableSize);
 }
@@ -102,10 +176,23 @@ HashTable::HashTable() {
 /**
  * Destructor
  */
-HashTable::~HashTable() {
+template<typename Hash>
+HashTable<Hash>::~HashTable() {
     // Implement logic to free storage when class is destroyed
-	// use the erase method of a vector to free the storage
-	nodes.erase(nodes.begin());
+	// the buckets are freed with their vector, their chains with the pool
+}
+
+/**
+ * Remove every bid. The table keeps its buckets and the memory of its
+ * chained nodes, to be filled again by the next load
+ */
+template<typename Hash>
+void HashTable<Hash>::Clear() {
+	vector<Node>().swap(oldNodes);
+	migrated = 0;
+	nodes.assign(tableSize, Node());
+	pool.Reset();
+	size = 0;
 }
 
 /**
@@ -115,71 +202,233 @@ HashTable::~HashTable() {
  * of a negative list index.
  *
  * @param key The key to hash
+ * @param buckets The number of buckets of the table
  * @return The calculated hash
  */
-unsigned int HashTable::hash(int key) {
+template<typename Hash>
+unsigned int HashTable<Hash>::hash(unsigned int key, unsigned int buckets) const {
     // Implement logic to calculate a hash value
-	// use modulo division to calculate hash value
-	return key % tableSize;
+	// the policy hashes the key and reduces it to a bucket
+	return Hash::bucket(key, buckets);
 }
 
 /**
- * Insert a bid
+ * Put a bid at the end of a bucket
  *
+ * @param table The buckets
+ * @param key The bucket of the bid
  * @param bid The bid to insert
+ * @return The node now holding the bid
  */
-void HashTable::Insert(Bid bid) {
-    // Implement logic to insert a bid
-	// will call hash method on the bid id passed in
-	//  c_str() converts string object to string of characters
-	// a to i converts ASCII string to an integer
-	unsigned key = hash(atoi(bid.bidId.c_str()));
-
+template<typename Hash>
+typename HashTable<Hash>::Node* HashTable<Hash>::place(vector<Node>& table, unsigned int key, const Bid& bid) {
 	// try and retrieve node using the key
-	// look for the old node address
-	Node* oldNode = &(nodes.at(key));
-
-	// if no entry found for this entry
-	if(oldNode == nullptr){
-	// if no node is found at this address, insert one with the bid and key
-      Node* newNode = new Node(bid, key);
-      // insert the node into the vector at this position plus the offset
-      nodes.insert(nodes.begin() + key, (*newNode));
-
-	} else {
-		// node found with something in it, look at it and see if something is in it
-		// if it has not been used, give it the bid and the key
-		if(oldNode->key == UINT_MAX){
-			// old node key equals key created above
-			oldNode->key = key;
-			// old node bid equals the bid given
-			oldNode->bid = bid;
-			// make sure pointer is null
-			oldNode->next = nullptr;
-		} else {
-			// find the next open node(last)
-			// if the next node is not null, make it be the next one
-			while(oldNode->next != nullptr){
-				oldNode = oldNode->next;
+	// look for the old node address, every bucket has one
+	Node* oldNode = &(table.at(key));
+
+	// node found with something in it, look at it and see if something is in it
+	// if it has not been used, give it the bid and the key
+	if(oldNode->key == UINT_MAX){
+		// old node key equals key created above
+		oldNode->key = key;
+		// old node bid equals the bid given
+		oldNode->bid = bid;
+		// make sure pointer is null
+		oldNode->next = nullptr;
+		return oldNode;
+	}
+
+	// find the next open node(last)
+	// if the next node is not null, make it be the next one
+	while(oldNode->next != nullptr){
+		oldNode = oldNode->next;
+	}
+	oldNode->next = pool.New(bid, key);
+	return oldNode->next;
+}
+
+/**
+ * Start growing the table to a number of buckets. The current buckets
+ * become the old ones, still to be moved
+ *
+ * @param buckets The number of buckets of the grown table
+ */
+template<typename Hash>
+void HashTable<Hash>::grow(unsigned int buckets) {
+	// a table grown again before its last growth is over finishes that first
+	rehash(UINT_MAX);
+
+	oldNodes.swap(nodes);
+	migrated = 0;
+	tableSize = buckets;
+	nodes.assign(tableSize, Node());
+}
+
+/**
+ * Move some old buckets to the grown table. The chained nodes are only
+ * relinked, the first bid of a bucket is copied
+ *
+ * @param steps How many old buckets to move at most
+ */
+template<typename Hash>
+void HashTable<Hash>::rehash(unsigned int steps) {
+	for (; steps > 0 && migrated < oldNodes.size(); --steps) {
+		Node* head = &oldNodes[migrated++];
+		if (head->key == UINT_MAX) {
+			continue;
+		}
+		place(nodes, hash(head->bid.bidId, tableSize), head->bid);
+
+		Node* node = head->next;
+		while (node != nullptr) {
+			Node* next = node->next;
+			unsigned int key = hash(node->bid.bidId, tableSize);
+			Node* tail = &nodes[key];
+			if (tail->key == UINT_MAX) {
+				// an empty bucket keeps its first bid in place
+				place(nodes, key, node->bid);
+				pool.Delete(node);
+			} else {
+				while (tail->next != nullptr) {
+					tail = tail->next;
+				}
+				node->key = key;
+				node->next = nullptr;
+				tail->next = node;
 			}
-			oldNode->next = new Node(bid, key);
+			node = next;
 		}
+		head->key = UINT_MAX;
+		head->next = nullptr;
+	}
 
+	// every old bucket has been moved
+	if (!oldNodes.empty() && migrated == oldNodes.size()) {
+		vector<Node>().swap(oldNodes);
+		migrated = 0;
 	}
+}
 
+/**
+ * Insert a bid built from the arguments of one of its constructors. Its
+ * id decides the bucket, so it is built once and copied into the table
+ *
+ * @param args The arguments of a Bid constructor
+ * @return The bid as stored in the table
+ */
+template<typename Hash>
+template<typename... Args>
+const Bid &HashTable<Hash>::Emplace(Args&&... args) {
+	return Insert(Bid(std::forward<Args>(args)...));
+}
+
+/**
+ * Insert a bid
+ *
+ * @param bid The bid to insert
+ * @return The bid as stored in the table, until the next insert or remove
+ */
+template<typename Hash>
+const Bid &HashTable<Hash>::Insert(const Bid &bid) {
+    // Implement logic to insert a bid
+	rehash(REHASH_STEP);
+
+	// will call hash method on the bid id passed in, new bids always go
+	// to the grown table
+	Node* node = place(nodes, hash(bid.bidId, tableSize), bid);
+	size++;
+
+	// the current buckets are kept as they are by growing, so node stays.
+	// A table of more than half the largest size can't double any more
+	if (size > tableSize * MAX_LOAD && tableSize <= UINT_MAX / 2) {
+		grow(Hash::buckets(tableSize * 2));
+	}
+	return node->bid;
+}
+
+/**
+ * Make room for a number of bids, so loading them grows the table at
+ * most once, now. Meant to be called before a bulk load
+ *
+ * @param count The number of bids the table will hold
+ */
+template<typename Hash>
+void HashTable<Hash>::Reserve(unsigned int count) {
+	unsigned int buckets = Hash::buckets(count / MAX_LOAD + 1);
+	if (buckets <= tableSize) {
+		return;
+	}
+	grow(buckets);
+	rehash(UINT_MAX);
+}
+
+/**
+ * Print the bids of some buckets
+ *
+ * @param table The buckets
+ * @param first The first bucket to print
+ */
+template<typename Hash>
+void HashTable<Hash>::printAll(const vector<Node>& table, unsigned int first) {
+	for (unsigned int i = first; i < table.size(); i++) {
+		if (table[i].key == UINT_MAX) {
+			continue;
+		}
+		for (const Node* node = &table[i]; node != nullptr; node = node->next) {
+			const Bid &bid = node->bid;
+			cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount() << " | "<< bid.getFund() << endl;
+		}
+	}
 }
 
 /**
  * Print all bids
  */
-void HashTable::PrintAll() {
+template<typename Hash>
+void HashTable<Hash>::PrintAll() {
     // Implement logic to print all bids
-	for (unsigned int i = 0; i < nodes.size(); i++) {
-		Bid bid = nodes[i].bid;
-		cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "<< bid.fund << endl;
+	printAll(oldNodes, migrated);
+	printAll(nodes, 0);
+}
+
+/**
+ * Unlink a bid from a bucket
+ *
+ * @param table The buckets
+ * @param key The bucket of the bid
+ * @param bidId The bid id to remove
+ * @return Whether the bid was there
+ */
+template<typename Hash>
+bool HashTable<Hash>::removeFrom(vector<Node>& table, unsigned int key, unsigned int bidId) {
+	Node* head = &table[key];
+	if (head->key == UINT_MAX) {
+		return false;
 	}
 
+	// the first bid of a bucket is in the vector, the next one takes its place
+	if (head->bid.bidId == bidId) {
+		Node* next = head->next;
+		if (next != nullptr) {
+			head->bid = next->bid;
+			head->next = next->next;
+			pool.Delete(next);
+		} else {
+			head->key = UINT_MAX;
+			head->bid = Bid();
+		}
+		return true;
+	}
 
+	for (Node* prev = head; prev->next != nullptr; prev = prev->next) {
+		if (prev->next->bid.bidId == bidId) {
+			Node* node = prev->next;
+			prev->next = node->next;
+			pool.Delete(node);
+			return true;
+		}
+	}
+	return false;
 }
 
 /**
@@ -187,49 +436,203 @@ void HashTable::PrintAll() {
  *
  * @param bidId The bid id to search for
  */
-void HashTable::Remove(string bidId) {
+template<typename Hash>
+void HashTable<Hash>::Remove(unsigned int bidId) {
     // Implement logic to remove a bid
-	unsigned key = hash(atoi(bidId.c_str()));
-	nodes.erase(nodes.begin() + key);
+	rehash(REHASH_STEP);
+
+	// a bid in a bucket not moved yet is still in the old table
+	if (!oldNodes.empty()) {
+		unsigned key = hash(bidId, oldNodes.size());
+		if (key >= migrated && removeFrom(oldNodes, key, bidId)) {
+			size--;
+			return;
+		}
+	}
+	if (removeFrom(nodes, hash(bidId, tableSize), bidId)) {
+		size--;
+	}
 }
 
 /**
- * Search for the specified bidId
+ * Remove a bid
+ *
+ * @param bidId The bid id to search for, as typed
+ */
+template<typename Hash>
+void HashTable<Hash>::Remove(string_view bidId) {
+	Remove(Bid::parseId(bidId));
+}
+
+/**
+ * Walk a bucket for a bid
  *
+ * @param table The buckets
+ * @param key The bucket of the bid
  * @param bidId The bid id to search for
+ * @return The bid in the bucket, nullptr if there is none
  */
-Bid HashTable::Search(string bidId) {
-    Bid bid;
+template<typename Hash>
+const Bid *HashTable<Hash>::searchIn(const vector<Node>& table, unsigned int key, unsigned int bidId) {
+	//try and retrieve node using the key
+	const Node* node = &(table.at(key));
 
+	//if no entry found
+	if (node->key == UINT_MAX) {
+		return nullptr;
+	}
+
+	//walk the linked list to find the match
+	while (node != nullptr) {
+		if (node->bid.bidId == bidId) {
+			return &node->bid;
+		}
+		node = node->next;
+	}
+
+    return nullptr;
+}
+
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in the table, nullptr if there is none
+ */
+template<typename Hash>
+const Bid *HashTable<Hash>::Search(unsigned int bidId) const {
     // Implement logic to search for and return a bid
+	// a bid in a bucket not moved yet is still in the old table
+	if (!oldNodes.empty()) {
+		unsigned key = hash(bidId, oldNodes.size());
+		if (key >= migrated) {
+			const Bid* bid = searchIn(oldNodes, key, bidId);
+			if (bid != nullptr) {
+				return bid;
+			}
+		}
+	}
+
     //calculate the key for this bid
-    unsigned key = hash(atoi(bidId.c_str()));
+    return searchIn(nodes, hash(bidId, tableSize), bidId);
+}
 
-	//try and retrieve node using the key
-	Node* node = &(nodes.at(key));
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for, as typed
+ * @return The bid in the table, nullptr if there is none
+ */
+template<typename Hash>
+const Bid *HashTable<Hash>::Search(string_view bidId) const {
+	return Search(Bid::parseId(bidId));
+}
 
-	//if no entry found
-	if (node == nullptr || node->key == UINT_MAX) {
-		return bid;
+/**
+ * Search for many bids at once. The ids are hashed SEARCH_BATCH at a
+ * time and their buckets prefetched before any is read, so the cache
+ * misses of those lookups overlap instead of following one another
+ *
+ * @param bidIds The bid ids to search for
+ * @param bids Where to put the bid of each id, nullptr if there is none,
+ *        as many as there are ids
+ */
+template<typename Hash>
+void HashTable<Hash>::SearchBatch(span<const unsigned int> bidIds, span<const Bid*> bids) const {
+	// while the table grows, a bid may still be in an old bucket
+	if (!oldNodes.empty()) {
+		for (size_t i = 0; i < bidIds.size(); i++) {
+			bids[i] = Search(bidIds[i]);
+		}
+		return;
 	}
 
-	//if node found that matches key
-	if (node != nullptr && node->key != UINT_MAX
-			&& node->bid.bidId.compare(bidId) == 0) {
-		return node->bid;
+	unsigned int keys[SEARCH_BATCH];
+	for (size_t first = 0; first < bidIds.size(); first += SEARCH_BATCH) {
+		size_t count = min(SEARCH_BATCH, bidIds.size() - first);
+		for (size_t i = 0; i < count; i++) {
+			keys[i] = hash(bidIds[first + i], tableSize);
+			__builtin_prefetch(&nodes[keys[i]]);
+		}
+		for (size_t i = 0; i < count; i++) {
+			bids[first + i] = searchIn(nodes, keys[i], bidIds[first + i]);
+		}
 	}
+}
 
-	//walk the linked list to find the match
-	while (node != nullptr) {
-		if (node->key != UINT_MAX && node->bid.bidId.compare(bidId) == 0) {
-			return node->bid;
+/**
+ * Search for many bids at once
+ *
+ * @param bidIds The bid ids to search for, as typed
+ * @param bids Where to put the bid of each id, nullptr if there is none,
+ *        as many as there are ids
+ */
+template<typename Hash>
+void HashTable<Hash>::SearchBatch(span<const string_view> bidIds, span<const Bid*> bids) const {
+	unsigned int ids[SEARCH_BATCH];
+	for (size_t first = 0; first < bidIds.size(); first += SEARCH_BATCH) {
+		size_t count = min(SEARCH_BATCH, bidIds.size() - first);
+		for (size_t i = 0; i < count; i++) {
+			ids[i] = Bid::parseId(bidIds[first + i]);
 		}
-		node = node->next;
+		SearchBatch(span<const unsigned int>(ids, count), bids.subspan(first, count));
+	}
+}
+
+/**
+ * Search for a bid as a coroutine, suspended after each prefetch of the
+ * next node it reads : its bucket, then the nodes chained after it
+ *
+ * @param bidId The bid id to search for
+ * @return The lookup, its result the bid or nullptr
+ */
+template<typename Hash>
+interleave::Lookup HashTable<Hash>::interleavedSearch(unsigned int bidId) const {
+	// while the table grows, a bid may still be in an old bucket
+	if (!oldNodes.empty()) {
+		co_return Search(bidId);
 	}
 
+	const Node* node = &nodes[hash(bidId, tableSize)];
+	co_await interleave::Prefetch{ node };
+	if (node->key == UINT_MAX) {
+		co_return nullptr;
+	}
+	for (;;) {
+		if (node->bid.bidId == bidId) {
+			co_return &node->bid;
+		}
+		node = node->next;
+		if (node == nullptr) {
+			co_return nullptr;
+		}
+		co_await interleave::Prefetch{ node };
+	}
+}
 
+/**
+ * Search for many bids at once, with a number of lookups in flight that
+ * take turns while the others wait on memory
+ *
+ * @param bidIds The bid ids to search for
+ * @param bids Where to put the bid of each id, nullptr if there is none,
+ *        as many as there are ids
+ * @param width How many lookups to have in flight
+ */
+template<typename Hash>
+void HashTable<Hash>::SearchInterleaved(span<const unsigned int> bidIds, span<const Bid*> bids,
+		size_t width) const {
+	interleave::run(bidIds, bids, width, [this](unsigned int bidId) {
+		return interleavedSearch(bidId);
+	});
+}
 
-    return bid;
+/**
+ * Returns the number of bids in the table
+ */
+template<typename Hash>
+unsigned int HashTable<Hash>::Size() const {
+	return size;
 }
 
 //============================================================================
@@ -241,9 +644,9 @@ Bid HashTable::Search(string bidId) {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
-    cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
-            << bid.fund << endl;
+void displayBid(const Bid &bid) {
+    cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount() << " | "
+            << bid.getFund() << endl;
     return;
 }
 
@@ -251,53 +654,661 @@ void displayBid(Bid bid) {
  * Load a CSV file containing bids into a container
  *
  * @param csvPath the path to the CSV file to load
- * @return a container holding all the bids read
+ * @return how far the CSV file was read, to load the bids appended later
  */
-void loadBids(string csvPath, HashTable* hashTable) {
+uint64_t loadBids(string csvPath, HashTable<>* hashTable) {
+    // a snapshot of the bids is kept next to the CSV file and mapped
+    // instead of parsing the file again, as long as the file is unchanged
+    string snapPath = csvPath + ".snap";
+    if (snapshot::upToDate(snapPath, csvPath)) {
+        cout << "Loading snapshot " << snapPath << endl;
+        try {
+            snapshot::Reader snap(snapPath);
+            // the number of bids is known, the table is sized once
+            hashTable->Reserve(snap.size());
+            for (unsigned int i = 0; i < snap.size(); i++) {
+                snapshot::Entry entry = snap[i];
+                hashTable->Emplace(entry.bidId, entry.title, entry.fund, entry.amount);
+            }
+            return snap.sourceSize();
+        } catch (snapshot::Error &e) {
+            std::cerr << e.what() << std::endl;
+            // the bids read so far go, the CSV file is read instead
+            hashTable->Clear();
+        }
+    }
+
     cout << "Loading CSV file " << csvPath << endl;
 
-    // initialize the CSV Parser using the given path
-    csv::Parser file = csv::Parser(csvPath);
+    // stream the CSV file using the given path, one block at a time, so
+    // bids are inserted while the rest of the file is still being read
+    csv::Stream file(csvPath);
+
+    // the file may still be written to : a last line without its newline
+    // is left for loadNewBids, which reads on from where this load stops.
+    // A malformed row is skipped rather than ending the load
+    file.setFollow(true);
+    file.setErrorMode(csv::eLENIENT);
 
     // read and display header row - optional
-    vector<string> header = file.getHeader();
+    const vector<string>& header = file.getHeader();
     for (auto const& c : header) {
         cout << c << " | ";
     }
     cout << "" << endl;
 
+    // the snapshot is written again once the whole file has been read
+    snapshot::Writer writer(snapPath, csvPath);
+
     try {
-        // loop to read rows of a CSV file
-        for (unsigned int i = 0; i < file.rowCount(); i++) {
+        // decode the rows of the CSV file straight into a bid as they
+        // are read
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
 
-            // Create a data structure and add to the collection of bids
-            Bid bid;
-            bid.bidId = file[i][1];
-            bid.title = file[i][0];
-            bid.fund = file[i][8];
-            bid.amount = strToDouble(file[i][4], '$');
+            //cout << "Item: " << bid.getTitle() << ", Fund: " << bid.getFund() << ", Amount: " << bid.getAmount() << endl;
 
-            //cout << "Item: " << bid.title << ", Fund: " << bid.fund << ", Amount: " << bid.amount << endl;
+            writer.add(bid.bidId, bid.getTitle(), bid.getFund(), bid.amount);
 
             // push this bid to the end
             hashTable->Insert(bid);
         }
+        writer.commit(file.consumed());
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+    } catch (snapshot::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
+    }
+    return file.offset();
+}
+
+/**
+ * Load the bids appended to a CSV file since it was last read, like
+ * tail -f : only the new part of the file is read
+ *
+ * @param csvPath the path to the CSV file to load
+ * @param offset how far the CSV file was read last time
+ * @return how far the CSV file is read now
+ */
+uint64_t loadNewBids(string csvPath, uint64_t offset, HashTable<>* hashTable) {
+    csv::Stream file(csvPath);
+    file.setFollow(true);
+    file.setErrorMode(csv::eLENIENT);
+    unsigned int count = 0;
+
+    try {
+        file.seek(offset);
+
+        // loop over the complete rows written since
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            hashTable->Insert(bid);
+            count++;
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
+    }
+
+    cout << count << " new bids read" << endl;
+    return file.offset();
+}
+
+/**
+ * Time loading the bids of a CSV file into a new hash table and looking
+ * every one of them up again, the bids being handed out by reference or,
+ * as Search used to, copied out
+ *
+ * @param csvPath the path to the CSV file to read
+ */
+void timeLoadAndQuery(string csvPath) {
+    const int passes = 20;
+
+    // decode the file first, so only the table is timed
+    vector<Bid> bids;
+    try {
+        csv::Stream file(csvPath);
+        file.setErrorMode(csv::eLENIENT);
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            bids.push_back(bid);
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    // once growing as the bids come, once sized for all of them first,
+    // with the longest single insert : the table grows without a pause.
+    // Then once more into the same table cleared, its nodes reused
+    const char* rounds[] = { "insert: ", "insert after Reserve: ", "insert after Clear: " };
+    HashTable<>* hashTable = nullptr;
+    for (int round = 0; round < 3; ++round) {
+        if (round < 2) {
+            delete hashTable;
+            hashTable = new HashTable<>();
+        } else {
+            hashTable->Clear();
+        }
+
+        clock_t longest = 0;
+        clock_t ticks = clock();
+        if (round == 1) {
+            hashTable->Reserve(bids.size());
+        }
+        for (const Bid& bid : bids) {
+            clock_t start = clock();
+            hashTable->Insert(bid);
+            longest = max(longest, clock() - start);
+        }
+        ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+        cout << rounds[round] << ticks
+                << " clock ticks, " << ticks * 1.0 / CLOCKS_PER_SEC
+                << " seconds, longest insert " << longest << " clock ticks" << endl;
+    }
+
+    int64_t byReference = 0;
+    clock_t ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Bid& bid : bids) {
+            const Bid* found = hashTable->Search(bid.bidId);
+            if (found != nullptr) {
+                byReference += found->amount;
+            }
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "search by reference: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    int64_t byCopy = 0;
+    ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Bid& bid : bids) {
+            const Bid* found = hashTable->Search(bid.bidId);
+            Bid copy;
+            if (found != nullptr) {
+                copy = *found;
+            }
+            byCopy += copy.amount;
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "search with a copy: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    cout << passes << " x " << bids.size() << " searches, totals "
+            << byReference << " / " << byCopy << endl;
+
+    delete hashTable;
+}
+
+#ifdef __linux__
+/**
+ * Hardware counter of the cache misses of this process, where the
+ * kernel lets it be read (not in most virtual machines)
+ */
+class CacheMissCounter {
+
+private:
+    int fd;
+
+public:
+    CacheMissCounter() {
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    virtual ~CacheMissCounter() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    bool Available() {
+        return fd >= 0;
+    }
+    void Start() {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t Stop() {
+        uint64_t count = 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            return 0;
+        }
+        return count;
+    }
+};
+#else
+/**
+ * perf_event_open is Linux only, elsewhere the counter is never available
+ */
+class CacheMissCounter {
+
+public:
+    bool Available() {
+        return false;
+    }
+    void Start() {
+    }
+    uint64_t Stop() {
+        return 0;
+    }
+};
+#endif
+
+/**
+ * Time searching a table for every bid of a list, then for as many ids
+ * that are not in it, and display the lookup rate and the cache misses
+ * per lookup
+ *
+ * @param name the name of the table to display
+ * @param table the table holding the bids
+ * @param bids the bids to look up
+ */
+template<typename Table>
+void timeSearches(const char* name, const Table& table, const vector<Bid>& bids) {
+    const int passes = 20;
+    CacheMissCounter misses;
+    int64_t total = 0;
+
+    for (int absent = 0; absent < 2; ++absent) {
+        // no auction id goes past a million, these are never found
+        unsigned int shift = absent ? 1000000 : 0;
+
+        if (misses.Available()) {
+            misses.Start();
+        }
+        clock_t ticks = clock();
+        for (int pass = 0; pass < passes; ++pass) {
+            for (const Bid& bid : bids) {
+                const Bid* found = table.Search(bid.bidId + shift);
+                if (found != nullptr) {
+                    total += found->amount;
+                }
+            }
+        }
+        ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+
+        double lookups = passes * bids.size();
+        double seconds = ticks * 1.0 / CLOCKS_PER_SEC;
+        cout << name << (absent ? " search (absent): " : " search: ")
+                << seconds << " seconds";
+        if (seconds > 0) {
+            cout << ", " << lookups / seconds / 1e6 << " M lookups/s";
+        }
+        if (misses.Available()) {
+            cout << ", " << misses.Stop() / lookups << " cache misses/lookup";
+        } else {
+            cout << ", cache misses unavailable";
+        }
+        cout << endl;
+    }
+    cout << name << " total " << total << endl;
+}
+
+/**
+ * Time removing every bid of a list from a table and inserting it back,
+ * so the table keeps its size while its entries churn
+ *
+ * @param name the name of the table to display
+ * @param table the table holding the bids
+ * @param bids the bids to remove and insert again
+ */
+template<typename Table>
+void timeRemoves(const char* name, Table& table, const vector<Bid>& bids) {
+    const int passes = 20;
+
+    clock_t ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Bid& bid : bids) {
+            table.Remove(bid.bidId);
+        }
+        for (const Bid& bid : bids) {
+            table.Insert(bid);
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+
+    double operations = 2.0 * passes * bids.size();
+    double seconds = ticks * 1.0 / CLOCKS_PER_SEC;
+    cout << name << " remove and insert: " << seconds << " seconds";
+    if (seconds > 0) {
+        cout << ", " << operations / seconds / 1e6 << " M operations/s";
+    }
+    cout << ", " << table.Size() << " bids" << endl;
+}
+
+/**
+ * Load the bids of a CSV file into the chained hash table and into the
+ * open addressing one, then compare their lookups
+ *
+ * @param csvPath the path to the CSV file to read
+ */
+void compareTables(string csvPath) {
+    // decode the file first, so only the tables are timed
+    vector<Bid> bids;
+    try {
+        csv::Stream file(csvPath);
+        file.setErrorMode(csv::eLENIENT);
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            bids.push_back(bid);
+        }
     } catch (csv::Error &e) {
         std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    HashTable<>* chained = new HashTable<>();
+    clock_t ticks = clock();
+    for (const Bid& bid : bids) {
+        chained->Insert(bid);
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "chained insert: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    FlatHashTable* flat = new FlatHashTable();
+    ticks = clock();
+    for (const Bid& bid : bids) {
+        flat->Insert(bid);
     }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "flat insert: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds, "
+            << flat->Size() << " bids in " << flat->Capacity() << " slots" << endl;
+
+    timeSearches("chained", *chained, bids);
+    timeSearches("flat", *flat, bids);
+
+    timeRemoves("chained", *chained, bids);
+    timeRemoves("flat", *flat, bids);
+    cout << "flat after churn: " << flat->Capacity() << " slots, "
+            << flat->Tombstones() << " tombstones" << endl;
+
+    delete chained;
+    delete flat;
 }
 
 /**
- * Simple C function to convert a string to a double
- * after stripping out unwanted char
+ * Spread a set of ids over a number of buckets with a hash policy, and
+ * display how even it is and how fast
  *
- * credit: http://stackoverflow.com/a/24875936
+ * @param ids the bid ids
+ * @param buckets the number of buckets to spread them over
+ */
+template<typename Policy>
+void reportHash(const vector<unsigned int>& ids, unsigned int buckets) {
+    const int passes = 100;
+    vector<unsigned int> counts(buckets, 0);
+
+    for (unsigned int id : ids) {
+        counts[Policy::bucket(id, buckets)]++;
+    }
+
+    unsigned int used = 0;
+    unsigned int longest = 0;
+    double visits = 0;
+    for (unsigned int count : counts) {
+        used += count > 0;
+        longest = max(longest, count);
+        // a search walks the chain up to its bid
+        visits += count * (count + 1) / 2.0;
+    }
+
+    // the same sum for keys spread at random, 1.0 means as good as that
+    double n = ids.size();
+    double expected = n / (2.0 * buckets) * (n + 2.0 * buckets - 1);
+
+    unsigned int sum = 0;
+    clock_t ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (unsigned int id : ids) {
+            sum += Policy::bucket(id, buckets);
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+
+    cout << Policy::name() << ", " << buckets << " buckets: "
+            << used << " used, " << ids.size() - used << " ids collide, longest chain "
+            << longest << ", " << visits / n << " nodes per search, uniformity "
+            << visits / expected << ", "
+            << ticks * 1e9 / CLOCKS_PER_SEC / (passes * n) << " ns per hash (checksum "
+            << sum << ")" << endl;
+}
+
+/**
+ * Compare the hash policies on the ids of a CSV file : collisions and
+ * chain lengths with as many buckets as the table would have for them,
+ * and with the fixed table it used to have
+ *
+ * @param csvPath the path to the CSV file to read
+ */
+void reportHashes(string csvPath) {
+    vector<unsigned int> ids;
+    try {
+        csv::Stream file(csvPath);
+        file.setErrorMode(csv::eLENIENT);
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            ids.push_back(bid.bidId);
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+    if (ids.empty()) {
+        return;
+    }
+
+    unsigned int count = ids.size() / MAX_LOAD + 1;
+    cout << ids.size() << " ids from " << *min_element(ids.begin(), ids.end())
+            << " to " << *max_element(ids.begin(), ids.end()) << endl;
+    reportHash<bidhash::Modulo>(ids, DEFAULT_SIZE);
+    reportHash<bidhash::Modulo>(ids, bidhash::Modulo::buckets(count));
+    reportHash<bidhash::Mask>(ids, bidhash::Mask::buckets(count));
+    reportHash<bidhash::FastRange>(ids, bidhash::FastRange::buckets(count));
+}
+
+/**
+ * Search the concurrent table from more and more threads, up to one per
+ * core, first alone and then while another thread keeps removing bids
+ * and inserting them back. Times are wall clock : clock() adds up the
+ * time of every thread.
  *
- * @param ch The character to strip out
+ * @param csvPath the path to the CSV file to read
+ */
+void timeConcurrentSearch(string csvPath) {
+    const int passes = 20;
+
+    vector<Bid> bids;
+    try {
+        csv::Stream file(csvPath);
+        file.setErrorMode(csv::eLENIENT);
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
+            bids.push_back(bid);
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+    if (bids.empty()) {
+        return;
+    }
+
+    ConcurrentHashTable* table = new ConcurrentHashTable();
+    table->Reserve(bids.size());
+    for (const Bid& bid : bids) {
+        table->Insert(bid);
+    }
+
+    unsigned int cores = max(1u, thread::hardware_concurrency());
+    vector<unsigned int> counts;
+    for (unsigned int count = 1; count < cores; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(cores);
+
+    cout << cores << " cores, " << bids.size() << " bids" << endl;
+    for (int writing = 0; writing < 2; ++writing) {
+        for (unsigned int count : counts) {
+            atomic<bool> done(false);
+            atomic<int64_t> found(0);
+            int64_t writes = 0;
+
+            auto start = chrono::steady_clock::now();
+
+            // the writer churns the first tenth of the bids, so a reader
+            // may find one of them or not
+            thread writer;
+            if (writing) {
+                writer = thread([&]() {
+                    size_t churned = bids.size() / 10 + 1;
+                    while (!done.load(memory_order_relaxed)) {
+                        for (size_t i = 0; i < churned; ++i) {
+                            table->Remove(bids[i].bidId);
+                            table->Insert(bids[i]);
+                        }
+                        writes += 2 * churned;
+                    }
+                });
+            }
+
+            vector<thread> readers;
+            for (unsigned int t = 0; t < count; ++t) {
+                readers.emplace_back([&, t]() {
+                    int64_t hits = 0;
+                    Bid bid;
+                    // each thread starts at its own place in the bids
+                    size_t first = t * bids.size() / count;
+                    for (int pass = 0; pass < passes; ++pass) {
+                        for (size_t i = 0; i < bids.size(); ++i) {
+                            size_t j = first + i < bids.size() ? first + i : first + i - bids.size();
+                            hits += table->Search(bids[j].bidId, bid);
+                        }
+                    }
+                    found += hits;
+                });
+            }
+            for (thread& reader : readers) {
+                reader.join();
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            done = true;
+            if (writing) {
+                writer.join();
+            }
+
+            double lookups = double(passes) * bids.size() * count;
+            cout << count << (count == 1 ? " reader" : " readers")
+                    << (writing ? " and a writer: " : ": ") << seconds << " seconds, "
+                    << lookups / seconds / 1e6 << " M lookups/s, "
+                    << lookups / seconds / 1e6 / count << " M/s per reader, "
+                    << found.load() << " found";
+            if (writing) {
+                cout << ", " << writes / seconds / 1e6 << " M writes/s";
+            }
+            cout << endl;
+        }
+    }
+
+    delete table;
+}
+
+/**
+ * Look up random ids in tables of more and more bids, one Search at a
+ * time, then by SearchBatch and by SearchInterleaved, in requests of a
+ * thousand ids. A bucket
+ * takes 40 bytes : the largest table, some 320 MB, is well past the size
+ * of the processor caches
  */
-double strToDouble(string str, char ch) {
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    return atof(str.c_str());
+void timeSearchBatch() {
+    const size_t lookups = 1 << 22;
+    const size_t request = 1000;
+
+    mt19937 random(260);
+    vector<const Bid*> found(request);
+
+    for (unsigned int count : { 1u << 16, 1u << 20, 1u << 23 }) {
+        HashTable<>* hashTable = new HashTable<>();
+        hashTable->Reserve(count);
+        Bid bid;
+        for (unsigned int id = 1; id <= count; ++id) {
+            bid.bidId = id;
+            bid.amount = id;
+            hashTable->Insert(bid);
+        }
+
+        // one id in eight is not in the table
+        vector<unsigned int> ids(lookups);
+        uniform_int_distribution<unsigned int> pick(1, count + count / 8);
+        for (unsigned int& id : ids) {
+            id = pick(random);
+        }
+
+        int64_t single = 0;
+        clock_t ticks = clock();
+        for (unsigned int id : ids) {
+            const Bid* found = hashTable->Search(id);
+            if (found != nullptr) {
+                single += found->amount;
+            }
+        }
+        ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+        double singleSeconds = ticks * 1.0 / CLOCKS_PER_SEC;
+
+        // the same requests, batched then interleaved
+        int64_t batched[2] = { 0, 0 };
+        double seconds[2];
+        for (int interleaved = 0; interleaved < 2; ++interleaved) {
+            ticks = clock();
+            for (size_t first = 0; first < ids.size(); first += request) {
+                size_t n = min(request, ids.size() - first);
+                span<const unsigned int> bidIds(&ids[first], n);
+                span<const Bid*> bids(found.data(), n);
+                if (interleaved) {
+                    hashTable->SearchInterleaved(bidIds, bids);
+                } else {
+                    hashTable->SearchBatch(bidIds, bids);
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    if (found[i] != nullptr) {
+                        batched[interleaved] += found[i]->amount;
+                    }
+                }
+            }
+            ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+            seconds[interleaved] = ticks * 1.0 / CLOCKS_PER_SEC;
+        }
+
+        cout << count << " bids:" << endl;
+        cout << "  Search: " << singleSeconds << " seconds, "
+                << lookups / singleSeconds / 1e6 << " M lookups/s" << endl;
+        const char* names[] = { "  SearchBatch: ", "  SearchInterleaved: " };
+        for (int interleaved = 0; interleaved < 2; ++interleaved) {
+            cout << names[interleaved] << seconds[interleaved] << " seconds, "
+                    << lookups / seconds[interleaved] / 1e6 << " M lookups/s, "
+                    << singleSeconds / seconds[interleaved] << " times faster" << endl;
+            if (single != batched[interleaved]) {
+                cout << "  totals differ: " << single << " / " << batched[interleaved] << endl;
+            }
+        }
+
+        delete hashTable;
+    }
 }
 
 /**
@@ -325,9 +1336,12 @@ int main(int argc, char* argv[]) {
     clock_t ticks;
 
     // Define a hash table to hold all the bids
-    HashTable* bidTable;
+    HashTable<>* bidTable = nullptr;
+
+    const Bid* bid;
 
-    Bid bid;
+    // how far the CSV file has been read
+    uint64_t csvOffset = 0;
 
     int choice = 0;
     while (choice != 9) {
@@ -336,20 +1350,31 @@ int main(int argc, char* argv[]) {
         cout << "  2. Display All Bids" << endl;
         cout << "  3. Find Bid" << endl;
         cout << "  4. Remove Bid" << endl;
+        cout << "  5. Load New Bids" << endl;
+        cout << "  6. Time Load and Query" << endl;
+        cout << "  7. Compare Chained and Flat Tables" << endl;
+        cout << "  8. Hash Distribution Report" << endl;
         cout << "  9. Exit" << endl;
+        cout << "  10. Concurrent Search Scaling" << endl;
+        cout << "  11. Batched and Interleaved Search" << endl;
         cout << "Enter choice: ";
         cin >> choice;
 
         switch (choice) {
 
         case 1:
-            bidTable = new HashTable();
+            // loading again reuses the table and the memory of its bids
+            if (bidTable == nullptr) {
+                bidTable = new HashTable<>();
+            } else {
+                bidTable->Clear();
+            }
 
             // Initialize a timer variable before loading bids
             ticks = clock();
 
             // Complete the method call to load the bids
-            loadBids(csvPath, bidTable);
+            csvOffset = loadBids(csvPath, bidTable);
 
             // Calculate elapsed time and display result
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
@@ -368,8 +1393,8 @@ int main(int argc, char* argv[]) {
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (bid != nullptr) {
+                displayBid(*bid);
             } else {
                 cout << "Bid Id " << searchValue << " not found." << endl;
             }
@@ -381,9 +1406,41 @@ int main(int argc, char* argv[]) {
         case 4:
             bidTable->Remove(searchValue);
             break;
+
+        case 5:
+            ticks = clock();
+
+            csvOffset = loadNewBids(csvPath, csvOffset, bidTable);
+
+            ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+            cout << "time: " << ticks << " clock ticks" << endl;
+            cout << "time: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+            break;
+
+        case 6:
+            timeLoadAndQuery(csvPath);
+            break;
+
+        case 7:
+            compareTables(csvPath);
+            break;
+
+        case 8:
+            reportHashes(csvPath);
+            break;
+
+        case 10:
+            timeConcurrentSearch(csvPath);
+            break;
+
+        case 11:
+            timeSearchBatch();
+            break;
         }
     }
 
+    delete bidTable;
+
     cout << "Good bye." << endl;
 
     return 0;
@@ -0,0 +1,109 @@
+#ifndef     _NODEPOOL_HPP_
+# define    _NODEPOOL_HPP_
+
+# include <cstddef>
+# include <memory>
+# include <new>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+/*
+** Allocator of the chained nodes of a hash table. Nodes are carved out of
+** slabs of SLAB of them, a freed node goes on a free list and is the next
+** one handed out. Nothing is given back to the heap before the pool is
+** destroyed : Reset makes every slab free again at once, so reloading a
+** table reuses the memory of its last load instead of allocating it
+** anew, one node at a time.
+**
+** The nodes are not destroyed one by one when their slabs are released,
+** they must not need to be.
+*/
+template<typename T, std::size_t SLAB = 1024>
+class NodePool
+{
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "pooled nodes are released without being destroyed");
+
+  public:
+    NodePool(void);
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+  public:
+    template<typename... Args>
+    T *New(Args&&... args);
+    void Delete(T *node);
+    void Reset(void);
+    std::size_t Slabs(void) const;
+
+  private:
+    // a free slot holds the next free one, a used slot a node
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char node[sizeof(T)];
+    };
+
+  private:
+    std::vector<std::unique_ptr<Slot[]>> _slabs;
+    Slot *_free;
+    // slots handed out of the slabs in order so far, freed ones included
+    std::size_t _handed;
+};
+
+template<typename T, std::size_t SLAB>
+NodePool<T, SLAB>::NodePool(void)
+  : _free(nullptr), _handed(0)
+{
+}
+
+/*
+** A freed slot first, else the next slot never handed out, in a new slab
+** when the last one is used up
+*/
+template<typename T, std::size_t SLAB>
+template<typename... Args>
+T *NodePool<T, SLAB>::New(Args&&... args)
+{
+    Slot *slot = _free;
+
+    if (slot != nullptr)
+        _free = slot->next;
+    else
+    {
+        std::size_t slab = _handed / SLAB;
+        if (slab == _slabs.size())
+            _slabs.emplace_back(new Slot[SLAB]);
+        slot = &_slabs[slab][_handed % SLAB];
+        _handed++;
+    }
+    return new (slot->node) T(std::forward<Args>(args)...);
+}
+
+template<typename T, std::size_t SLAB>
+void NodePool<T, SLAB>::Delete(T *node)
+{
+    Slot *slot = reinterpret_cast<Slot *>(node);
+
+    slot->next = _free;
+    _free = slot;
+}
+
+/*
+** Every node is free again, the slabs are kept for the next ones
+*/
+template<typename T, std::size_t SLAB>
+void NodePool<T, SLAB>::Reset(void)
+{
+    _free = nullptr;
+    _handed = 0;
+}
+
+template<typename T, std::size_t SLAB>
+std::size_t NodePool<T, SLAB>::Slabs(void) const
+{
+    return _slabs.size();
+}
+
+#endif /*!_NODEPOOL_HPP_*/
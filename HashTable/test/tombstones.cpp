@@ -0,0 +1,106 @@
+//============================================================================
+// Name        : tombstones.cpp
+// Description : Rows deleted by an eAPPEND Parser stay deleted for a
+//               Parser in any mode, and for one that rewrites the file
+//============================================================================
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CSVparser.hpp"
+
+using namespace std;
+
+int status = 0;
+
+/**
+ * Report a failed check
+ *
+ * @param ok whether the check passed
+ * @param what what was checked
+ */
+void check(bool ok, const string &what) {
+    if (!ok) {
+        cout << "FAIL: " << what << endl;
+        status = 1;
+    }
+}
+
+/**
+ * The first column of every row a Stream reads from a file, space separated
+ *
+ * @param path the CSV file
+ */
+string streamed(const string &path) {
+    string ids;
+    csv::Stream file(path);
+    for (auto const& row : file) {
+        ids += (ids.empty() ? "" : " ") + string(row.view(0));
+    }
+    return ids;
+}
+
+/**
+ * The first column of every row of a Parser, space separated
+ *
+ * @param parser the parser
+ */
+string parsed(const csv::Parser &parser) {
+    string ids;
+    for (unsigned int i = 0; i < parser.rowCount(); i++) {
+        ids += (ids.empty() ? "" : " ") + string(parser.getRow(i).view(0));
+    }
+    return ids;
+}
+
+int main(int argc, char* argv[]) {
+    string path = string(argc > 1 ? argv[1] : ".") + "/r.csv";
+    string del = path + ".del";
+
+    ofstream out(path);
+    out << "id,name" << endl;
+    for (int i = 1; i <= 8; i++) {
+        out << i << ",row " << i << endl;
+    }
+    out.close();
+    remove(del.c_str());
+
+    // delete the second row in append mode : only a tombstone is written
+    {
+        csv::Parser parser(path);
+        parser.setSyncMode(csv::eAPPEND);
+        parser.deleteRow(1);
+        parser.sync();
+    }
+    check(streamed(path) == "1 3 4 5 6 7 8", "Stream skips the tombstoned row");
+
+    // a Parser in the default mode, read as a copy or mapped, skips it too
+    {
+        csv::Parser mapped(path, csv::eMAPPED);
+        check(parsed(mapped) == "1 3 4 5 6 7 8", "mapped eREWRITE Parser skips the tombstoned row");
+    }
+    {
+        csv::Parser parser(path);
+        check(parsed(parser) == "1 3 4 5 6 7 8", "eREWRITE Parser skips the tombstoned row");
+
+        // and rewriting the file leaves it out for good
+        parser.addRow(parser.rowCount(), { "9", "row 9" });
+        parser.sync();
+    }
+    check(streamed(path) == "1 3 4 5 6 7 8 9", "rewritten file keeps the row deleted");
+    check(!ifstream(del).good(), "tombstone file removed by the rewrite");
+    {
+        csv::Parser parser(path);
+        parser.setSyncMode(csv::eAPPEND);
+        check(parsed(parser) == "1 3 4 5 6 7 8 9", "eAPPEND Parser after the rewrite");
+    }
+
+    remove(path.c_str());
+    if (status == 0) {
+        cout << "PASS" << endl;
+    }
+    return status;
+}
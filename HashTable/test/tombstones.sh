@@ -0,0 +1,10 @@
+#!/bin/sh
+# Regression test : rows deleted by a Parser in eAPPEND mode are not
+# brought back by a Parser in eREWRITE mode on the same file.
+#
+# Run from the project directory : sh test/tombstones.sh
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+${CXX:-g++} -std=c++20 -Isrc -o "$dir/tombstones" test/tombstones.cpp src/CSVparser.cpp -lz -ldl -lpthread || exit 1
+"$dir/tombstones" "$dir"
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Regression test : a half-written last line of a CSV file is not loaded
+# as a bid. Load New Bids reads it once the rest of it is appended, and
+# the snapshot is reused while only that line is missing.
+#
+# Run from the project directory once built : sh test/unterminated_line.sh
+program=${1:-./Debug/HashTable}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+csv=$dir/unterminated.csv
+printf 'ArticleTitle,ArticleID,Department,CloseDate,WinningBid,InventoryID,VehicleID,ReceiptNumber,Fund\n' > "$csv"
+printf 'Desk,98001,Surplus,12/1/16,10.5,1,,42,General Fund\n' >> "$csv"
+printf 'Chair,98223,Surplus,12/1/16,71.88,2,,43,General Fu' >> "$csv"
+
+status=0
+fail() {
+    echo "FAIL: $1"
+    status=1
+}
+
+# load, find 98223
+find() {
+    printf '1\n3\n9\n' | "$program" "$csv" 98223
+}
+
+for run in csv snapshot; do
+    out=$(find)
+    echo "$out" | grep -q "98223: Chair" && fail "$run: half-written bid 98223 loaded"
+    [ $run = snapshot ] && ! echo "$out" | grep -q "Loading snapshot" && fail "snapshot not reused"
+done
+
+# the writer finishes the line while the program runs
+out=$( { printf '1\n'; sleep 1; printf 'nd\n' >> "$csv"; printf '5\n3\n9\n'; } | "$program" "$csv" 98223)
+echo "$out" | grep -q "1 new bids read" || fail "completed line not read by Load New Bids"
+echo "$out" | grep -q "98223: Chair | 71.88 | General Fund$" || fail "completed bid 98223 not found"
+
+for run in csv snapshot; do
+    out=$(find)
+    echo "$out" | grep -q "98223: Chair | 71.88 | General Fund$" || fail "$run: completed bid 98223 not found"
+    [ $run = snapshot ] && ! echo "$out" | grep -q "Loading snapshot" && fail "snapshot not reused"
+done
+
+[ $status = 0 ] && echo "PASS"
+exit $status
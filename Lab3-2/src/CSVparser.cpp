@@ -1,144 +1,814 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <iterator>
+#include <thread>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+#include <zlib.h>
 #include "CSVparser.hpp"
 
 namespace csv {
 
-  Parser::Parser(const std::string &data, const DataType &type, char sep)
-    : _type(type), _sep(sep)
+#if defined(__AVX2__) || defined(__SSE2__)
+  /*
+  ** Vector scan : compare a whole block of the line at once against '"'
+  ** and sep, giving one bit per byte for each. The quoted areas are the
+  ** prefix-XOR of the quote bits, as in simdjson/simdcsv, so separators
+  ** inside quotes are dropped without looking at bytes one by one.
+  */
+# if defined(__AVX2__)
+  static const std::size_t SCAN_WIDTH = 32;
+
+  static inline void scanBlock(const char *p, char sep, uint32_t &quotes, uint32_t &seps)
+  {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      quotes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+      seps = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(sep)));
+  }
+# else
+  static const std::size_t SCAN_WIDTH = 16;
+
+  static inline void scanBlock(const char *p, char sep, uint32_t &quotes, uint32_t &seps)
+  {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      quotes = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+      seps = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(sep)));
+  }
+# endif
+
+  /*
+  ** Bit i of the result is the parity of the quotes at or before i
+  */
+  static inline uint32_t prefixXor(uint32_t bits)
+  {
+      bits ^= bits << 1;
+      bits ^= bits << 2;
+      bits ^= bits << 4;
+      bits ^= bits << 8;
+      bits ^= bits << 16;
+      return bits;
+  }
+#endif
+
+  /*
+  ** Split one record on sep, ignoring separators inside double quotes,
+  ** and hand every field to emit(column, value) as a view into line.
+  ** Returns the number of fields found.
+  */
+  template<typename Emit>
+  static std::size_t splitFields(std::string_view line, char sep, Emit emit)
+  {
+      std::size_t column = 0;
+      bool quoted = false;
+      std::size_t tokenStart = 0;
+      std::size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+      uint32_t inQuotes = 0; // all ones while a quote is left open
+
+      for (; i + SCAN_WIDTH <= line.length(); i += SCAN_WIDTH)
+      {
+          uint32_t quotes;
+          uint32_t seps;
+
+          scanBlock(line.data() + i, sep, quotes, seps);
+          uint32_t quotedMask = prefixXor(quotes) ^ inQuotes;
+          seps &= ~quotedMask;
+          inQuotes = ((quotedMask >> (SCAN_WIDTH - 1)) & 1) ? ~0u : 0u;
+
+          while (seps != 0)
+          {
+              std::size_t pos = i + __builtin_ctz(seps);
+              emit(column++, line.substr(tokenStart, pos - tokenStart));
+              tokenStart = pos + 1;
+              seps &= seps - 1;
+          }
+      }
+      quoted = (inQuotes != 0);
+#endif
+
+      // what is left of the line, or all of it without SIMD
+      for (; i != line.length(); i++)
+      {
+          if (line[i] == '"')
+              quoted = ((quoted) ? (false) : (true));
+          else if (line[i] == sep && !quoted)
+          {
+              emit(column++, line.substr(tokenStart, i - tokenStart));
+              tokenStart = i + 1;
+          }
+      }
+
+      //end
+      emit(column++, line.substr(tokenStart, line.length() - tokenStart));
+      return column;
+  }
+
+  /*
+  ** Tokenize one line into fields (offsets from the start of the line),
+  ** laid out as the projection asks. Returns false, with the reason, when
+  ** the line does not have the expected number of columns.
+  */
+  static bool splitInto(std::string_view line, char sep, const Projection &projection,
+                        unsigned int columns, Field *fields, Rejects::Reason &reason)
+  {
+      if (line.size() >= Field::ARENA)
+      {
+          reason = Rejects::eLINE_TOO_LONG;
+          return false;
+      }
+
+      auto place = [&](std::size_t at, std::string_view value)
+      {
+          fields[at].offset = value.data() - line.data();
+          fields[at].length = value.size();
+      };
+      std::size_t count;
+
+      if (projection.empty())
+          count = splitFields(line, sep, [&](std::size_t column, std::string_view value)
+          {
+              if (column < columns)
+                  place(column, value);
+          });
+      else
+          count = splitFields(line, sep, [&](std::size_t column, std::string_view value)
+          {
+              int at = projection.slot(column);
+              if (at >= 0)
+                  place(at, value);
+          });
+
+      if (count == columns)
+          return true;
+      reason = (count < columns) ? Rejects::eMISSING_FIELDS : Rejects::eEXTRA_FIELDS;
+      return false;
+  }
+
+  /*
+  ** A record splitInto turned down : counted when lenient, fatal when not
+  */
+  static void reject(ErrorMode errors, Rejects &rejects, Rejects::Reason reason,
+                     std::size_t line, std::string_view text)
+  {
+      if (errors == eSTRICT)
+      {
+          if (reason == Rejects::eLINE_TOO_LONG)
+              throw Error("line too long");
+          if (reason == Rejects::eBAD_VALUE)
+              throw Error("bad value");
+          throw Error("corrupted data !");
+      }
+      rejects.add(reason, line, text);
+  }
+
+  /*
+  ** Number conversions working on the field bytes. Nothing is allocated :
+  ** when a copy is needed it goes to a small buffer on the stack.
+  */
+  static std::string_view skipBlanks(std::string_view text)
+  {
+      std::size_t i = 0;
+      while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '"'))
+          i++;
+      return text.substr(i);
+  }
+
+  static long long toInt(std::string_view text)
+  {
+      text = skipBlanks(text);
+      if (!text.empty() && text[0] == '+')
+          text.remove_prefix(1);
+
+      long long value = 0;
+      std::from_chars(text.data(), text.data() + text.size(), value);
+      return value;
+  }
+
+  static double toDouble(std::string_view text)
+  {
+      text = skipBlanks(text);
+      if (!text.empty() && text[0] == '+')
+          text.remove_prefix(1);
+
+      double value = 0.0;
+#if defined(__cpp_lib_to_chars)
+      std::from_chars(text.data(), text.data() + text.size(), value);
+#else
+      char buffer[64];
+      std::size_t length = std::min(text.size(), sizeof(buffer) - 1);
+      std::memcpy(buffer, text.data(), length);
+      buffer[length] = '\0';
+      value = std::strtod(buffer, nullptr);
+#endif
+      return value;
+  }
+
+  /*
+  ** Amounts such as $1,234.56, -$12.00, $-12.00 or ($12.00). Up to 15
+  ** digits the value is built exactly as an integer and scaled once,
+  ** which gives the same double as strtod, longer ones go through it.
+  */
+  static double toCurrency(std::string_view text)
+  {
+      static const double scale[] = {
+          1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+          1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+      };
+      bool negative = false;
+      std::size_t i = 0;
+
+      // sign, parenthesis and currency sign come in any order
+      for (; i < text.size(); i++)
+      {
+          char c = text[i];
+          if (c == '-' || c == '(')
+              negative = true;
+          else if (c != ' ' && c != '\t' && c != '"' && c != '$' && c != '+')
+              break;
+      }
+
+      char digits[64];
+      std::size_t count = 0;
+      std::size_t point = 0;
+      bool fraction = false;
+      uint64_t mantissa = 0;
+
+      for (; i < text.size() && count < sizeof(digits) - 2; i++)
+      {
+          char c = text[i];
+          if (c >= '0' && c <= '9')
+          {
+              mantissa = mantissa * 10 + (c - '0');
+              digits[count++] = c;
+          }
+          else if (c == ',' && !fraction)
+              continue;
+          else if (c == '.' && !fraction)
+          {
+              fraction = true;
+              point = count;
+          }
+          else
+              break;
+      }
+
+      double value;
+      std::size_t decimals = fraction ? count - point : 0;
+      if (count <= 15)
+          value = mantissa / scale[decimals];
+      else
+      {
+          // too long to be exact as an integer, let strtod round it
+          if (fraction)
+          {
+              std::memmove(digits + point + 1, digits + point, decimals);
+              digits[point] = '.';
+              count++;
+          }
+          digits[count] = '\0';
+          value = std::strtod(digits, nullptr);
+      }
+      return negative ? -value : value;
+  }
+
+  /*
+  ** The same amounts as a whole number of cents, exactly : digits past
+  ** the second decimal only round the last cent, half away from zero.
+  */
+  static long long toCents(std::string_view text)
+  {
+      bool negative = false;
+      std::size_t i = 0;
+
+      for (; i < text.size(); i++)
+      {
+          char c = text[i];
+          if (c == '-' || c == '(')
+              negative = true;
+          else if (c != ' ' && c != '\t' && c != '"' && c != '$' && c != '+')
+              break;
+      }
+
+      long long cents = 0;
+      int decimals = -1;
+      bool roundUp = false;
+
+      for (; i < text.size(); i++)
+      {
+          char c = text[i];
+          if (c >= '0' && c <= '9')
+          {
+              if (decimals < 2)
+              {
+                  cents = cents * 10 + (c - '0');
+                  if (decimals >= 0)
+                      decimals++;
+              }
+              else if (decimals == 2)
+              {
+                  roundUp = (c >= '5');
+                  decimals++;
+              }
+          }
+          else if (c == ',' && decimals < 0)
+              continue;
+          else if (c == '.' && decimals < 0)
+              decimals = 0;
+          else
+              break;
+      }
+
+      for (int d = (decimals < 0) ? 0 : decimals; d < 2; d++)
+          cents *= 10;
+      if (roundUp)
+          cents++;
+      return negative ? -cents : cents;
+  }
+
+  std::size_t split(std::string_view line, char sep, std::string_view *fields,
+                    std::size_t size)
+  {
+      return splitFields(line, sep, [&](std::size_t column, std::string_view value)
+      {
+          if (column < size)
+              fields[column] = value;
+      });
+  }
+
+  void quoteMask(std::string_view buffer, uint64_t *mask)
+  {
+      bool quoted = false;
+      std::size_t i = 0;
+
+      std::fill(mask, mask + (buffer.size() + 63) / 64, 0);
+#if defined(__AVX2__) || defined(__SSE2__)
+      const uint64_t width = (uint64_t(1) << SCAN_WIDTH) - 1;
+      uint32_t inQuotes = 0; // all ones while a quote is left open
+
+      // SCAN_WIDTH divides 64, a block never straddles two words
+      for (; i + SCAN_WIDTH <= buffer.size(); i += SCAN_WIDTH)
+      {
+          uint32_t quotes;
+          uint32_t seps;
+
+          scanBlock(buffer.data() + i, '"', quotes, seps);
+          uint32_t quotedMask = prefixXor(quotes) ^ inQuotes;
+          inQuotes = ((quotedMask >> (SCAN_WIDTH - 1)) & 1) ? ~0u : 0u;
+          mask[i / 64] |= (quotedMask & width) << (i % 64);
+      }
+      quoted = (inQuotes != 0);
+#endif
+
+      for (; i != buffer.size(); i++)
+      {
+          if (buffer[i] == '"')
+              quoted = ((quoted) ? (false) : (true));
+          if (quoted)
+              mask[i / 64] |= uint64_t(1) << (i % 64);
+      }
+  }
+
+  void quoteMaskScalar(std::string_view buffer, uint64_t *mask)
+  {
+      bool quoted = false;
+
+      std::fill(mask, mask + (buffer.size() + 63) / 64, 0);
+      for (std::size_t i = 0; i != buffer.size(); i++)
+      {
+          if (buffer[i] == '"')
+              quoted = ((quoted) ? (false) : (true));
+          if (quoted)
+              mask[i / 64] |= uint64_t(1) << (i % 64);
+      }
+  }
+
+  long long parseInt(std::string_view text)
+  {
+      return toInt(text);
+  }
+
+  double parseDouble(std::string_view text)
+  {
+      return toDouble(text);
+  }
+
+  double parseCurrency(std::string_view text)
+  {
+      return toCurrency(text);
+  }
+
+  long long parseCents(std::string_view text)
+  {
+      return toCents(text);
+  }
+
+  /*
+  ** Read the next non-empty line of text, starting at pos
+  */
+  static bool nextLine(std::string_view text, std::size_t &pos, std::string_view &line)
+  {
+      while (pos < text.size())
+      {
+          std::size_t end = text.find('\n', pos);
+          if (end == std::string_view::npos)
+              end = text.size();
+          line = text.substr(pos, end - pos);
+          pos = end + 1;
+          if (!line.empty())
+              return true;
+      }
+      return false;
+  }
+
+  /*
+  ** Tombstone file kept next to a CSV file by sync() in eAPPEND mode
+  */
+  static std::string tombstonePath(const std::string &file)
+  {
+      return file + ".del";
+  }
+
+  /*
+  ** Record numbers listed in the tombstone file of file, sorted, none
+  ** when there is no such file
+  */
+  static std::vector<unsigned int> readTombstones(const std::string &file)
+  {
+      std::ifstream f(tombstonePath(file).c_str());
+      std::vector<unsigned int> numbers;
+      unsigned int number;
+
+      while (f >> number)
+          numbers.push_back(number);
+      std::sort(numbers.begin(), numbers.end());
+      numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+      return numbers;
+  }
+
+  // size of the blocks sync() hands to the file
+  static const std::size_t WRITE_BLOCK = 1 << 20;
+
+  /*
+  ** Build the shared header from the first line. columns is set to the
+  ** width of the file, the header only keeps the projected columns.
+  */
+  static std::shared_ptr<const Header> readHeader(std::string_view line, char sep,
+                                                  Projection &projection, unsigned int &columns)
+  {
+      std::stringstream ss{std::string(line)};
+      std::string item;
+      std::vector<std::string> names;
+
+      while (std::getline(ss, item, sep))
+          names.push_back(item);
+
+      // rows are checked against the file, but only carry the projection
+      columns = names.size();
+      if (!projection.empty())
+          names = projection.bind(names);
+      return std::make_shared<const Header>(names);
+  }
+
+  Parser::Parser(const std::string &data, const DataType &type, char sep, unsigned int threads,
+                 const Projection &projection, const ErrorMode &errors)
+    : _type(type), _sep(sep), _threads(threads), _projection(projection), _errors(errors),
+      _compressed(false), _columns(0), _mode(eREWRITE), _stored(0), _dead(0), _rewrite(false)
   {
-      std::string line;
-      if (type == eFILE)
+      if (type != ePURE && Inflater::compressed(data))
+      {
+        // inflated into memory, there is no file to map
+        static const std::size_t BLOCK = 1 << 20;
+        _file = data;
+        _compressed = true;
+        Inflater inflater(_file);
+        for (;;)
+        {
+            std::size_t size = _buffer.size();
+            _buffer.resize(size + BLOCK);
+            std::size_t count = inflater.read(&_buffer[size], BLOCK);
+            _buffer.resize(size + count);
+            if (count < BLOCK)
+                break;
+        }
+        _text = _buffer;
+
+        if (!parseHeader())
+          throw Error(std::string("No Data in ").append(_file));
+
+        parseContent();
+        dropTombstones();
+      }
+      else if (type == eFILE)
       {
         _file = data;
-        std::ifstream ifile(_file.c_str());
+        std::ifstream ifile(_file.c_str(), std::ios::binary);
         if (ifile.is_open())
         {
-            while (ifile.good())
-            {
-                getline(ifile, line);
-                if (line != "")
-                    _originalFile.push_back(line);
-            }
+            _buffer.assign(std::istreambuf_iterator<char>(ifile),
+                           std::istreambuf_iterator<char>());
             ifile.close();
+            _text = _buffer;
 
-            if (_originalFile.size() == 0)
+            if (!parseHeader())
               throw Error(std::string("No Data in ").append(_file));
             
-            parseHeader();
             parseContent();
+            dropTombstones();
         }
         else
             throw Error(std::string("Failed to open ").append(_file));
       }
+      else if (type == eMAPPED)
+      {
+        // rows are parsed straight out of the mapping, nothing is copied
+        _file = data;
+        _mapped.open(_file);
+        _text = _mapped.data();
+        if (!parseHeader())
+          throw Error(std::string("No Data in ").append(_file));
+
+        parseContent();
+        dropTombstones();
+      }
       else
       {
-        std::istringstream stream(data);
-        while (std::getline(stream, line))
-          if (line != "")
-            _originalFile.push_back(line);
-        if (_originalFile.size() == 0)
+        _buffer = data;
+        _text = _buffer;
+        if (!parseHeader())
           throw Error(std::string("No Data in pure content"));
 
-        parseHeader();
         parseContent();
       }
   }
 
   Parser::~Parser(void)
   {
-     std::vector<Row *>::iterator it;
-
-     for (it = _content.begin(); it != _content.end(); it++)
-          delete *it;
   }
 
-  void Parser::parseHeader(void)
+  bool Parser::parseHeader(void)
   {
-      std::stringstream ss(_originalFile[0]);
-      std::string item;
+      std::size_t pos = 0;
+      std::string_view line;
+
+      if (!nextLine(_text, pos, line))
+          return false;
+      _body = _text.substr(std::min(pos, _text.size()));
 
-      while (std::getline(ss, item, _sep))
-          _header.push_back(item);
+      _header = readHeader(line, _sep, _projection, _columns);
+      return true;
   }
 
   void Parser::parseContent(void)
   {
-     std::vector<std::string>::iterator it;
-     
-     it = _originalFile.begin();
-     it++; // skip header
+     // don't bother starting threads for less than a block per thread
+     std::size_t chunks = std::min<std::size_t>(_threads, _body.size() / (1 << 16));
+     // line numbers of rejects are counted from the start of the body
+     std::size_t bodyLine = 0;
+     if (_errors == eLENIENT)
+         bodyLine = std::count(_text.data(), _body.data(), '\n');
 
-     for (; it != _originalFile.end(); it++)
+     if (chunks <= 1)
      {
-         bool quoted = false;
-         int tokenStart = 0;
-         unsigned int i = 0;
+         Rejects rejects;
+         _stored = parseRange(_body, _records, _fields, rejects);
+         _rejects.merge(rejects, bodyLine);
+         return;
+     }
 
-         Row *row = new Row(_header);
+     // cut the body in byte ranges, each one pushed forward to the start
+     // of the next line. A record never spans lines (quoted separators,
+     // as in the Inventory ID lists, stay inside their line), so the
+     // start of a line is always a safe split point.
+     std::vector<std::string_view> ranges;
+     std::size_t start = 0;
+     for (std::size_t i = 1; i <= chunks; i++)
+     {
+         std::size_t end = _body.size() * i / chunks;
+         if (end <= start)
+             end = start;
+         else
+         {
+             std::size_t nl = _body.find('\n', end - 1);
+             end = (nl == std::string_view::npos) ? _body.size() : nl + 1;
+         }
+         ranges.push_back(_body.substr(start, end - start));
+         start = end;
+     }
 
-         for (; i != it->length(); i++)
+     std::vector<std::vector<Record> > records(ranges.size());
+     std::vector<std::vector<Field> > fields(ranges.size());
+     std::vector<std::size_t> numbers(ranges.size());
+     std::vector<Rejects> rejects(ranges.size());
+     std::vector<std::exception_ptr> errors(ranges.size());
+     auto work = [&](std::size_t i)
+     {
+         try
          {
-              if (it->at(i) == '"')
-                  quoted = ((quoted) ? (false) : (true));
-              else if (it->at(i) == ',' && !quoted)
-              {
-                  row->push(it->substr(tokenStart, i - tokenStart));
-                  tokenStart = i + 1;
-              }
+             numbers[i] = parseRange(ranges[i], records[i], fields[i], rejects[i]);
+         }
+         catch (...)
+         {
+             errors[i] = std::current_exception();
          }
+     };
 
-         //end
-         row->push(it->substr(tokenStart, it->length() - tokenStart));
+     std::vector<std::thread> workers;
+     for (std::size_t i = 1; i < ranges.size(); i++)
+         workers.emplace_back(work, i);
+     work(0);
+     for (auto it = workers.begin(); it != workers.end(); it++)
+         it->join();
 
-         // if value(s) missing
-         if (row->size() != _header.size())
-          throw Error("corrupted data !");
-         _content.push_back(row);
+     // report the first error in file order, as a single thread would
+     for (std::size_t i = 0; i < errors.size(); i++)
+     {
+         if (errors[i])
+             std::rethrow_exception(errors[i]);
+     }
+
+     std::size_t totalRecords = 0;
+     std::size_t totalFields = 0;
+     for (std::size_t i = 0; i < ranges.size(); i++)
+     {
+         totalRecords += records[i].size();
+         totalFields += fields[i].size();
+     }
+     _records.reserve(totalRecords);
+     _fields.reserve(totalFields);
+     std::size_t line = bodyLine;
+     for (std::size_t i = 0; i < ranges.size(); i++)
+     {
+         // each chunk numbered its records, fields and lines from 0
+         std::size_t shift = _fields.size();
+         for (auto it = records[i].begin(); it != records[i].end(); it++)
+         {
+             it->first += shift;
+             it->number += _stored;
+             _records.push_back(*it);
+         }
+         _fields.insert(_fields.end(), fields[i].begin(), fields[i].end());
+         _stored += numbers[i];
+
+         if (rejects[i].total() > 0)
+             _rejects.merge(rejects[i], line);
+         if (_errors == eLENIENT)
+             line += std::count(ranges[i].begin(), ranges[i].end(), '\n');
+     }
+  }
+
+  /*
+  ** Leave out the records listed in the tombstone file. Their fields
+  ** stay unused in the table, as for deleteRow. Records already left out
+  ** are not found again, so doing it twice changes nothing.
+  */
+  void Parser::dropTombstones(void)
+  {
+     std::vector<unsigned int> numbers = readTombstones(_file);
+     if (numbers.empty())
+         return;
+
+     // records are in file order, numbers sorted
+     auto dead = numbers.begin();
+     std::size_t kept = 0;
+     for (std::size_t i = 0; i < _records.size(); i++)
+     {
+         while (dead != numbers.end() && *dead < _records[i].number)
+             dead++;
+         if (dead != numbers.end() && *dead == _records[i].number)
+             continue;
+         _records[kept++] = _records[i];
+     }
+     _dead += _records.size() - kept;
+     _records.resize(kept);
+  }
+
+  /*
+  ** Parse the records of text, returns how many there are in the file,
+  ** rejected ones included. Line numbers are only counted when a record
+  ** is rejected, from where the last rejected one was.
+  */
+  std::size_t Parser::parseRange(std::string_view text, std::vector<Record> &records,
+                                 std::vector<Field> &fields, Rejects &rejects) const
+  {
+     std::size_t pos = 0;
+     std::string_view line;
+     unsigned int size = _header->size();
+     unsigned int number = 0;
+     std::size_t counted = 0;
+     std::size_t lines = 0;
+
+     while (nextLine(text, pos, line))
+     {
+         Record record;
+         record.base = line.data() - _text.data();
+         record.first = fields.size();
+         record.size = size;
+         record.number = number++;
+         fields.resize(record.first + size);
+
+         Rejects::Reason reason;
+         if (splitInto(line, _sep, _projection, _columns, &fields[record.first], reason))
+         {
+             records.push_back(record);
+             continue;
+         }
+
+         fields.resize(record.first);
+         std::size_t at = line.data() - text.data();
+         lines += std::count(text.data() + counted, text.data() + at, '\n');
+         counted = at;
+         reject(_errors, rejects, reason, lines + 1, line);
      }
+     return number;
+  }
+
+  Row Parser::makeRow(unsigned int rowPosition, Parser *owner) const
+  {
+      if (rowPosition >= _records.size())
+          throw Error("can't return this row (doesn't exist)");
+
+      const Record &record = _records[rowPosition];
+      return Row(_header.get(), _text.data() + record.base, _arena.data(),
+                 _fields.data() + record.first, record.size, owner, rowPosition);
+  }
+
+  Row Parser::getRow(unsigned int rowPosition)
+  {
+      return makeRow(rowPosition, this);
   }
 
-  Row &Parser::getRow(unsigned int rowPosition) const
+  Row Parser::getRow(unsigned int rowPosition) const
   {
-      if (rowPosition < _content.size())
-          return *(_content[rowPosition]);
-      throw Error("can't return this row (doesn't exist)");
+      return makeRow(rowPosition, nullptr);
+  }
+
+  Row Parser::operator[](unsigned int rowPosition)
+  {
+      return Parser::getRow(rowPosition);
   }
 
-  Row &Parser::operator[](unsigned int rowPosition) const
+  Row Parser::operator[](unsigned int rowPosition) const
   {
       return Parser::getRow(rowPosition);
   }
 
   unsigned int Parser::rowCount(void) const
   {
-      return _content.size();
+      return _records.size();
   }
 
   unsigned int Parser::columnCount(void) const
   {
-      return _header.size();
+      return _header->size();
   }
 
   std::vector<std::string> Parser::getHeader(void) const
   {
-      return _header;
+      return _header->names();
   }
 
   const std::string Parser::getHeaderElement(unsigned int pos) const
   {
-      if (pos >= _header.size())
+      if (pos >= _header->size())
         throw Error("can't return this header (doesn't exist)");
-      return _header[pos];
+      return _header->names()[pos];
+  }
+
+  unsigned int Parser::column(const std::string &name) const
+  {
+      return _header->column(name);
   }
 
   bool Parser::deleteRow(unsigned int pos)
   {
-    if (pos < _content.size())
+    if (pos < _records.size())
     {
-      delete *(_content.begin() + pos);
-      _content.erase(_content.begin() + pos);
+      // already in the file, eAPPEND syncs tombstone it
+      if (_records[pos].number != Record::UNSTORED)
+      {
+        _tombstones.push_back(_records[pos].number);
+        _dead++;
+      }
+      // its fields are left unused in the table
+      _records.erase(_records.begin() + pos);
       return true;
     }
     return false;
@@ -146,121 +816,1148 @@ namespace csv {
 
   bool Parser::addRow(unsigned int pos, const std::vector<std::string> &r)
   {
-    Row *row = new Row(_header);
+    if (pos > _records.size())
+      return false;
 
+    Record record;
+    record.base = 0;
+    record.first = _fields.size();
+    record.size = r.size();
+    record.number = Record::UNSTORED;
     for (auto it = r.begin(); it != r.end(); it++)
-      row->push(*it);
-    
-    if (pos <= _content.size())
-    {
-      _content.insert(_content.begin() + pos, row);
-      return true;
-    }
-    return false;
+      _fields.push_back(store(*it));
+
+    _records.insert(_records.begin() + pos, record);
+    return true;
   }
 
-  void Parser::sync(void) const
+  bool Parser::set(unsigned int row, const std::string &key, const std::string &value)
   {
-    if (_type == DataType::eFILE)
-    {
-      std::ofstream f;
-      f.open(_file, std::ios::out | std::ios::trunc);
+    int pos = _header->find(key);
 
-      // header
-      unsigned int i = 0;
-      for (auto it = _header.begin(); it != _header.end(); it++)
-      {
-        f << *it;
-        if (i < _header.size() - 1)
-          f << ",";
-        else
-          f << std::endl;
-        i++;
-      }
-     
-      for (auto it = _content.begin(); it != _content.end(); it++)
-        f << **it << std::endl;
-      f.close();
-    }
+    if (row >= _records.size() || pos < 0
+        || static_cast<unsigned int>(pos) >= _records[row].size)
+      return false;
+    _fields[_records[row].first + pos] = store(value);
+
+    // a stored row can't be changed by appending
+    if (_records[row].number != Record::UNSTORED)
+      _rewrite = true;
+    return true;
   }
 
-  const std::string &Parser::getFileName(void) const
+  void Parser::setSyncMode(SyncMode mode)
   {
-      return _file;    
+    _mode = mode;
   }
-  
-  /*
-  ** ROW
-  */
 
-  Row::Row(const std::vector<std::string> &header)
-      : _header(header) {}
+  Field Parser::store(std::string_view value)
+  {
+    if (_arena.size() + value.size() >= Field::ARENA)
+      throw Error("can't store this value (arena full)");
 
-  Row::~Row(void) {}
+    Field field;
+    field.offset = _arena.size();
+    field.length = value.size() | Field::ARENA;
+    _arena.append(value);
+    return field;
+  }
 
-  unsigned int Row::size(void) const
+  void Parser::sync(void)
   {
-    return _values.size();
+    // the dropped columns would be lost from the file
+    if (!_projection.empty())
+      throw Error("can't sync a projected parser");
+    if (_compressed)
+      throw Error("can't sync a compressed file");
+    if (_type == DataType::ePURE)
+      return;
+
+    if (_mode == eAPPEND && appendable())
+      append();
+    else
+      rewrite();
   }
 
-  void Row::push(const std::string &value)
+  void Parser::compact(void)
   {
-    _values.push_back(value);
+    if (!_projection.empty())
+      throw Error("can't sync a projected parser");
+    if (_compressed)
+      throw Error("can't sync a compressed file");
+    if (_type == DataType::ePURE)
+      return;
+
+    rewrite();
   }
 
-  bool Row::set(const std::string &key, const std::string &value) 
+  /*
+  ** Whether the file can be brought up to date by appending : no stored
+  ** row changed, stored rows still in file order with the new ones all
+  ** after them, and not so many tombstones that compaction is due.
+  */
+  bool Parser::appendable(void) const
   {
-    std::vector<std::string>::const_iterator it;
-    int pos = 0;
+    if (_rewrite || _dead * 4 > _stored)
+      return false;
 
-    for (it = _header.begin(); it != _header.end(); it++)
+    std::size_t next = 0;
+    bool added = false;
+    for (auto it = _records.begin(); it != _records.end(); it++)
     {
-        if (key == *it)
+      if (it->number == Record::UNSTORED)
+        added = true;
+      else if (added || it->number < next)
+        return false;
+      else
+        next = it->number + 1;
+    }
+    return true;
+  }
+
+  void Parser::append(void)
+  {
+    std::size_t first = _records.size();
+    while (first > 0 && _records[first - 1].number == Record::UNSTORED)
+      first--;
+
+    if (first < _records.size())
+    {
+      // the last line of the file may have no newline
+      std::ifstream in(_file.c_str(), std::ios::binary);
+      char last = '\n';
+      if (in.seekg(-1, std::ios::end))
+        in.get(last);
+      in.close();
+
+      std::ofstream f(_file.c_str(), std::ios::binary | std::ios::app);
+      if (last != '\n')
+        f.put('\n');
+      write(f, false, first);
+      f.close();
+      if (!f)
+        throw Error(std::string("Failed to write ").append(_file));
+
+      for (std::size_t i = first; i < _records.size(); i++)
+        _records[i].number = _stored++;
+    }
+
+    if (!_tombstones.empty())
+    {
+      std::string path(tombstonePath(_file));
+      std::ofstream f(path.c_str(), std::ios::app);
+      for (auto it = _tombstones.begin(); it != _tombstones.end(); it++)
+        f << *it << '\n';
+      f.close();
+      if (!f)
+        throw Error(std::string("Failed to write ").append(path));
+      _tombstones.clear();
+    }
+  }
+
+  void Parser::rewrite(void)
+  {
+    if (_rejects.total() > 0)
+      throw Error("can't rewrite a file with rejected records");
+
+    // tombstones left with the new file would hide the wrong rows, so
+    // they go first : a failure may bring deleted rows back, no more.
+    // Until the rewrite is done, the next sync has to rewrite as well
+    _rewrite = true;
+    std::string path(tombstonePath(_file));
+    if (std::remove(path.c_str()) != 0 && errno != ENOENT)
+      throw Error(std::string("Failed to remove ").append(path));
+
+    // rows may still point into the mapped file, so never truncate it :
+    // write a new one next to it and rename it over the old one
+    std::string tmp(_file + ".tmp");
+    std::ofstream f(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    write(f, true, 0);
+    f.close();
+    if (!f)
+    {
+      std::remove(tmp.c_str());
+      throw Error(std::string("Failed to write ").append(tmp));
+    }
+    if (std::rename(tmp.c_str(), _file.c_str()) != 0)
+      throw Error(std::string("Failed to replace ").append(_file));
+
+    for (std::size_t i = 0; i < _records.size(); i++)
+      _records[i].number = i;
+    _stored = _records.size();
+    _dead = 0;
+    _tombstones.clear();
+    _rewrite = false;
+  }
+
+  /*
+  ** Write the header if asked, then the rows from first on. Rows are
+  ** joined into a block handed to the file whenever it is full, rather
+  ** than going through the stream a field at a time.
+  */
+  void Parser::write(std::ofstream &f, bool header, std::size_t first) const
+  {
+      std::string block;
+      block.reserve(WRITE_BLOCK);
+
+      if (header)
+      {
+        const std::vector<std::string> &names = _header->names();
+        for (std::size_t i = 0; i < names.size(); i++)
         {
-          _values[pos] = value;
-          return true;
+          if (i > 0)
+            block += _sep;
+          block += names[i];
         }
-        pos++;
-    }
-    return false;
+        block += '\n';
+      }
+
+      for (std::size_t row = first; row < _records.size(); row++)
+      {
+        Row r = getRow(row);
+        for (unsigned int i = 0; i < r.size(); i++)
+        {
+          if (i > 0)
+            block += _sep;
+          block.append(r.view(i));
+        }
+        block += '\n';
+
+        if (block.size() >= WRITE_BLOCK)
+        {
+          f.write(block.data(), block.size());
+          block.clear();
+        }
+      }
+      f.write(block.data(), block.size());
   }
 
-  const std::string Row::operator[](unsigned int valuePosition) const
+  const std::string &Parser::getFileName(void) const
   {
-       if (valuePosition < _values.size())
-           return _values[valuePosition];
-       throw Error("can't return this value (doesn't exist)");
+      return _file;    
   }
 
-  const std::string Row::operator[](const std::string &key) const
+  const Rejects &Parser::rejects(void) const
+  {
+      return _rejects;
+  }
+  
+  /*
+  ** STREAM
+  */
+
+  Stream::Stream(const std::string &file, char sep, std::size_t blockSize)
+    : Stream(file, Projection(), sep, blockSize)
+  {
+  }
+
+  Stream::Stream(const std::string &file, const Projection &projection, char sep,
+                 std::size_t blockSize)
+    : _file(file), _sep(sep), _projection(projection), _columns(0),
+      _input(file.c_str(), std::ios::binary),
+      _buffer(blockSize > 0 ? blockSize : 1, '\0'), _pos(0), _end(0),
+      _base(0), _first(0), _eof(false), _follow(false), _errors(eSTRICT), _line(0),
+      _skip(readTombstones(file)), _skipPos(0), _number(0),
+      _row(nullptr, nullptr, nullptr, nullptr, 0)
+  {
+      if (!_input.is_open())
+          throw Error(std::string("Failed to open ").append(_file));
+      if (Inflater::compressed(_file))
+      {
+          _input.close();
+          _inflater.reset(new Inflater(_file));
+      }
+
+      std::string_view line;
+      if (!readLine(line))
+          throw Error(std::string("No Data in ").append(_file));
+
+      _header = readHeader(line, _sep, _projection, _columns);
+      _fields.resize(_header->size());
+      _first = offset();
+  }
+
+  Stream::~Stream(void)
+  {
+  }
+
+  void Stream::refill(void)
+  {
+      // keep the unfinished line at the front of the buffer
+      std::size_t left = _end - _pos;
+      _base += _pos;
+      std::memmove(&_buffer[0], _buffer.data() + _pos, left);
+      _pos = 0;
+      _end = left;
+
+      // a single line bigger than the whole buffer
+      if (_end == _buffer.size())
+          _buffer.resize(_buffer.size() * 2);
+
+      if (_inflater)
+      {
+          std::size_t wanted = _buffer.size() - _end;
+          std::size_t count = _inflater->read(&_buffer[_end], wanted);
+          _end += count;
+          if (count < wanted)
+              _eof = true;
+          return;
+      }
+
+      _input.read(&_buffer[_end], _buffer.size() - _end);
+      _end += _input.gcount();
+      if (!_input)
+          _eof = true;
+  }
+
+  bool Stream::readLine(std::string_view &line)
+  {
+      for (;;)
+      {
+          const char *begin = _buffer.data() + _pos;
+          const char *nl = static_cast<const char *>(std::memchr(begin, '\n', _end - _pos));
+
+          if (nl != nullptr)
+          {
+              line = std::string_view(begin, nl - begin);
+              _pos += line.size() + 1;
+              _line++;
+              if (!line.empty())
+                  return true;
+          }
+          else if (_eof)
+          {
+              // the last line may be half written : a follower leaves it
+              // in the buffer, and reads again from there next time
+              if (_follow && !_inflater)
+              {
+                  struct stat st;
+                  if (stat(_file.c_str(), &st) == 0
+                      && static_cast<std::uint64_t>(st.st_size) < _base + _end)
+                      throw Error(std::string("Truncated ").append(_file));
+                  _input.clear();
+                  _eof = false;
+                  return false;
+              }
+
+              // last line without a trailing newline
+              if (_pos == _end)
+                  return false;
+              line = std::string_view(begin, _end - _pos);
+              _pos = _end;
+              _line++;
+              return true;
+          }
+          else
+              refill();
+      }
+  }
+
+  /*
+  ** Read the next line holding a record, past tombstoned ones
+  */
+  bool Stream::nextRecord(std::string_view &line)
+  {
+      for (;;)
+      {
+          if (!readLine(line))
+              return false;
+
+          // records and tombstones both come in file order
+          unsigned int number = _number++;
+          while (_skipPos < _skip.size() && _skip[_skipPos] < number)
+              _skipPos++;
+          if (_skipPos == _skip.size() || _skip[_skipPos] != number)
+              return true;
+      }
+  }
+
+  void Stream::reject(Rejects::Reason reason, std::string_view line)
+  {
+      csv::reject(_errors, _rejects, reason, _line, line);
+  }
+
+  bool Stream::next(void)
+  {
+      std::string_view line;
+      Rejects::Reason reason;
+
+      while (nextRecord(line))
+      {
+          if (splitInto(line, _sep, _projection, _columns, _fields.data(), reason))
+          {
+              _row = Row(_header.get(), line.data(), nullptr, _fields.data(), _fields.size());
+              return true;
+          }
+          reject(reason, line);
+      }
+      return false;
+  }
+
+  const Row &Stream::getRow(void) const
+  {
+      return _row;
+  }
+
+  const std::vector<std::string> &Stream::getHeader(void) const
+  {
+      return _header->names();
+  }
+
+  unsigned int Stream::column(const std::string &name) const
+  {
+      return _header->column(name);
+  }
+
+  const std::string &Stream::getFileName(void) const
+  {
+      return _file;
+  }
+
+  const Rejects &Stream::rejects(void) const
+  {
+      return _rejects;
+  }
+
+  void Stream::setErrorMode(ErrorMode errors)
+  {
+      _errors = errors;
+  }
+
+  void Stream::setFollow(bool follow)
+  {
+      _follow = follow;
+  }
+
+  std::uint64_t Stream::offset(void) const
+  {
+      return _base + _pos;
+  }
+
+  /*
+  ** How much of the file itself has been read : offset() unless it is
+  ** compressed, the whole file once a compressed one is read through
+  */
+  std::uint64_t Stream::consumed(void) const
+  {
+      if (_inflater)
+          return _inflater->consumed();
+      return offset();
+  }
+
+  /*
+  ** Continue from offset, which must be the start of a record, as given
+  ** by offset(). Record numbers are lost, so tombstones only apply to a
+  ** stream that is not moved past its first record.
+  */
+  void Stream::seek(std::uint64_t offset)
+  {
+      if (_inflater)
+      {
+          if (offset == this->offset())
+              return;
+          throw Error(std::string("can't seek in compressed ").append(_file));
+      }
+
+      if (offset <= _first)
+      {
+          offset = _first;
+          _number = 0;
+          _skipPos = 0;
+      }
+      else
+          _skip.clear();
+
+      _input.clear();
+      if (!_input.seekg(offset))
+          throw Error(std::string("Failed to seek in ").append(_file));
+      _base = offset;
+      _pos = 0;
+      _end = 0;
+      _eof = false;
+      _line = 0;
+  }
+
+  Stream::iterator Stream::begin(void)
+  {
+      if (!next())
+          return end();
+      return iterator(this);
+  }
+
+  Stream::iterator Stream::end(void)
+  {
+      return iterator(nullptr);
+  }
+
+  /*
+  ** DICTIONARY
+  */
+
+  Dictionary::Dictionary(void)
   {
-      std::vector<std::string>::const_iterator it;
-      int pos = 0;
+      code(std::string_view());
+  }
+
+  unsigned int Dictionary::code(std::string_view value)
+  {
+      auto it = _codes.find(value);
+      if (it != _codes.end())
+          return it->second;
+
+      unsigned int code = _values.size();
+      _values.emplace_back(value);
+      _codes.emplace(_values.back(), code);
+      return code;
+  }
+
+  int Dictionary::find(std::string_view value) const
+  {
+      auto it = _codes.find(value);
+      if (it == _codes.end())
+          return -1;
+      return it->second;
+  }
+
+  const std::string &Dictionary::value(unsigned int code) const
+  {
+      if (code >= _values.size())
+          throw Error("can't return this value (not in the dictionary)");
+      return _values[code];
+  }
 
-      for (it = _header.begin(); it != _header.end(); it++)
+  unsigned int Dictionary::size(void) const
+  {
+      return _values.size();
+  }
+
+  /*
+  ** REJECTS
+  */
+
+  Rejects::Rejects(void)
+  {
+      for (unsigned int i = 0; i < REASONS; i++)
+          _counts[i] = 0;
+  }
+
+  void Rejects::add(Reason reason, std::size_t line, std::string_view text)
+  {
+      _counts[reason]++;
+      if (_kept.size() < KEPT)
       {
-          if (key == *it)
-              return _values[pos];
-          pos++;
+          Reject r;
+          r.line = line;
+          r.reason = reason;
+          r.text = std::string(text.substr(0, KEPT_TEXT));
+          _kept.push_back(r);
       }
-      
-      throw Error("can't return this value (doesn't exist)");
+  }
+
+  void Rejects::merge(const Rejects &other, std::size_t lineShift)
+  {
+      for (unsigned int i = 0; i < REASONS; i++)
+          _counts[i] += other._counts[i];
+      for (auto it = other._kept.begin(); it != other._kept.end() && _kept.size() < KEPT; it++)
+      {
+          _kept.push_back(*it);
+          _kept.back().line += lineShift;
+      }
+  }
+
+  std::size_t Rejects::count(Reason reason) const
+  {
+      return _counts[reason];
+  }
+
+  std::size_t Rejects::total(void) const
+  {
+      std::size_t total = 0;
+      for (unsigned int i = 0; i < REASONS; i++)
+          total += _counts[i];
+      return total;
+  }
+
+  const std::vector<Rejects::Reject> &Rejects::kept(void) const
+  {
+      return _kept;
+  }
+
+  const char *Rejects::describe(Reason reason)
+  {
+      switch (reason)
+      {
+        case eMISSING_FIELDS:
+          return "missing fields";
+        case eEXTRA_FIELDS:
+          return "extra fields";
+        case eLINE_TOO_LONG:
+          return "line too long";
+        case eBAD_VALUE:
+          return "bad value";
+      }
+      return "unknown";
+  }
+
+  std::ostream &operator<<(std::ostream &os, const Rejects &rejects)
+  {
+      os << rejects.total() << " records rejected";
+      for (unsigned int i = 0; i < Rejects::REASONS; i++)
+      {
+          Rejects::Reason reason = static_cast<Rejects::Reason>(i);
+          os << ((i == 0) ? " : " : ", ") << rejects.count(reason) << " "
+             << Rejects::describe(reason);
+      }
+      os << std::endl;
+
+      const std::vector<Rejects::Reject> &kept = rejects.kept();
+      for (auto it = kept.begin(); it != kept.end(); it++)
+          os << "  line " << it->line << " (" << Rejects::describe(it->reason) << ") : "
+             << it->text << std::endl;
+      if (kept.size() < rejects.total())
+          os << "  ..." << std::endl;
+      return os;
+  }
+
+  /*
+  ** INFLATER
+  */
+
+  static const unsigned char GZIP_MAGIC[2] = { 0x1f, 0x8b };
+  static const unsigned char ZSTD_MAGIC[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+  // compressed bytes read at once, inflated bytes handed over at once,
+  // and how many inflated blocks may wait for the reader
+  static const std::size_t INFLATE_INPUT = 1 << 18;
+  static const std::size_t INFLATE_BLOCK = 1 << 20;
+  static const std::size_t INFLATE_QUEUE = 4;
+
+  /*
+  ** The part of the libzstd API the inflater needs, looked up at run time
+  */
+  struct ZstdInBuffer
+  {
+      const void *src;
+      std::size_t size;
+      std::size_t pos;
+  };
+
+  struct ZstdOutBuffer
+  {
+      void *dst;
+      std::size_t size;
+      std::size_t pos;
+  };
+
+  struct Zstd
+  {
+      void *(*createDStream)(void);
+      std::size_t (*freeDStream)(void *);
+      std::size_t (*initDStream)(void *);
+      std::size_t (*decompressStream)(void *, ZstdOutBuffer *, ZstdInBuffer *);
+      unsigned int (*isError)(std::size_t);
+      const char *(*getErrorName)(std::size_t);
+  };
+
+  static const Zstd *loadZstd(void)
+  {
+      static const char *names[] = {
+          "libzstd.so.1", "libzstd.so", "libzstd.1.dylib", "libzstd.dylib"
+      };
+      void *library = nullptr;
+      for (std::size_t i = 0; library == nullptr && i < sizeof(names) / sizeof(*names); i++)
+          library = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+      if (library == nullptr)
+          return nullptr;
+
+      static Zstd zstd;
+      zstd.createDStream = reinterpret_cast<void *(*)(void)>(dlsym(library, "ZSTD_createDStream"));
+      zstd.freeDStream = reinterpret_cast<std::size_t (*)(void *)>(dlsym(library, "ZSTD_freeDStream"));
+      zstd.initDStream = reinterpret_cast<std::size_t (*)(void *)>(dlsym(library, "ZSTD_initDStream"));
+      zstd.decompressStream = reinterpret_cast<std::size_t (*)(void *, ZstdOutBuffer *, ZstdInBuffer *)>(
+          dlsym(library, "ZSTD_decompressStream"));
+      zstd.isError = reinterpret_cast<unsigned int (*)(std::size_t)>(dlsym(library, "ZSTD_isError"));
+      zstd.getErrorName = reinterpret_cast<const char *(*)(std::size_t)>(
+          dlsym(library, "ZSTD_getErrorName"));
+      if (!zstd.createDStream || !zstd.freeDStream || !zstd.initDStream
+          || !zstd.decompressStream || !zstd.isError || !zstd.getErrorName)
+          return nullptr;
+      return &zstd;
+  }
+
+  bool Inflater::compressed(const std::string &path)
+  {
+      std::ifstream f(path.c_str(), std::ios::binary);
+      unsigned char magic[4];
+
+      if (!f.read(reinterpret_cast<char *>(magic), sizeof(magic)))
+          return false;
+      return std::memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0
+          || std::memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0;
+  }
+
+  Inflater::Inflater(const std::string &path)
+    : _file(path), _consumed(0), _done(false), _stop(false), _pos(0)
+  {
+      _worker = std::thread(&Inflater::run, this);
+  }
+
+  Inflater::~Inflater(void)
+  {
+      {
+          std::lock_guard<std::mutex> lock(_lock);
+          _stop = true;
+      }
+      _space.notify_one();
+      _worker.join();
+  }
+
+  /*
+  ** Copy up to size inflated bytes to to, waiting for the thread when it
+  ** is behind. Less than size means the end of the file.
+  */
+  std::size_t Inflater::read(char *to, std::size_t size)
+  {
+      std::size_t done = 0;
+
+      while (done < size)
+      {
+          if (_pos == _current.size())
+          {
+              std::unique_lock<std::mutex> lock(_lock);
+              _ready.wait(lock, [this] { return !_blocks.empty() || _done; });
+              if (_blocks.empty())
+              {
+                  // report a failure once what came before it is read
+                  if (_error)
+                      std::rethrow_exception(_error);
+                  break;
+              }
+              _current.swap(_blocks.front());
+              _blocks.pop_front();
+              _pos = 0;
+              _space.notify_one();
+          }
+
+          std::size_t count = std::min(size - done, _current.size() - _pos);
+          std::memcpy(to + done, _current.data() + _pos, count);
+          _pos += count;
+          done += count;
+      }
+      return done;
+  }
+
+  std::uint64_t Inflater::consumed(void) const
+  {
+      return _consumed;
+  }
+
+  void Inflater::run(void)
+  {
+      try
+      {
+          std::ifstream in(_file.c_str(), std::ios::binary);
+          unsigned char magic[4] = { 0, 0, 0, 0 };
+
+          if (!in.is_open())
+              throw Error(std::string("Failed to open ").append(_file));
+          in.read(reinterpret_cast<char *>(magic), sizeof(magic));
+          in.clear();
+          in.seekg(0);
+
+          if (std::memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0)
+              inflateZstd(in);
+          else
+              inflateGzip(in);
+      }
+      catch (...)
+      {
+          std::lock_guard<std::mutex> lock(_lock);
+          _error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(_lock);
+      _done = true;
+      _ready.notify_one();
+  }
+
+  /*
+  ** Hand an inflated block to the reader, waiting while the queue is full.
+  ** Returns false when the reader is gone.
+  */
+  bool Inflater::push(std::string &block)
+  {
+      std::unique_lock<std::mutex> lock(_lock);
+      _space.wait(lock, [this] { return _stop || _blocks.size() < INFLATE_QUEUE; });
+      if (_stop)
+          return false;
+      _blocks.push_back(std::string());
+      _blocks.back().swap(block);
+      _ready.notify_one();
+      return true;
+  }
+
+  void Inflater::inflateGzip(std::ifstream &in)
+  {
+      z_stream z;
+      std::memset(&z, 0, sizeof(z));
+      // 32 : accept a gzip or a zlib header
+      if (inflateInit2(&z, 15 + 32) != Z_OK)
+          throw Error("can't start zlib");
+
+      std::string input(INFLATE_INPUT, '\0');
+      std::string output;
+      bool member = false;
+      bool full = false;
+      bool stopped = false;
+
+      try
+      {
+          for (;;)
+          {
+              // zlib may hold more output while the last block was full
+              if (z.avail_in == 0 && !full)
+              {
+                  in.read(&input[0], input.size());
+                  z.next_in = reinterpret_cast<Bytef *>(&input[0]);
+                  z.avail_in = in.gcount();
+                  _consumed += z.avail_in;
+                  if (z.avail_in == 0)
+                      break;
+              }
+
+              output.resize(INFLATE_BLOCK);
+              z.next_out = reinterpret_cast<Bytef *>(&output[0]);
+              z.avail_out = output.size();
+              int status = inflate(&z, Z_NO_FLUSH);
+              if (status == Z_STREAM_END)
+              {
+                  // concatenated files carry one member each
+                  inflateReset(&z);
+                  member = false;
+              }
+              else if (status == Z_OK || status == Z_BUF_ERROR)
+                  member = true;
+              else
+                  throw Error(std::string("corrupted ").append(_file)
+                              .append(z.msg ? std::string(" : ").append(z.msg) : ""));
+
+              full = (z.avail_out == 0);
+              output.resize(output.size() - z.avail_out);
+              if (!output.empty() && !push(output))
+              {
+                  stopped = true;
+                  break;
+              }
+          }
+          if (member && !stopped)
+              throw Error(std::string("truncated ").append(_file));
+      }
+      catch (...)
+      {
+          inflateEnd(&z);
+          throw;
+      }
+      inflateEnd(&z);
+  }
+
+  void Inflater::inflateZstd(std::ifstream &in)
+  {
+      static const Zstd *zstd = loadZstd();
+      if (zstd == nullptr)
+          throw Error(std::string("libzstd is needed to read ").append(_file));
+
+      void *stream = zstd->createDStream();
+      if (stream == nullptr)
+          throw Error("can't start zstd");
+      zstd->initDStream(stream);
+
+      std::string input(INFLATE_INPUT, '\0');
+      std::string output;
+      ZstdInBuffer from = { input.data(), 0, 0 };
+      std::size_t hint = 0;
+      bool full = false;
+      bool stopped = false;
+
+      try
+      {
+          for (;;)
+          {
+              // the decoder may hold more output while the last block was full
+              if (from.pos == from.size && !full)
+              {
+                  in.read(&input[0], input.size());
+                  from.size = in.gcount();
+                  from.pos = 0;
+                  _consumed += from.size;
+                  if (from.size == 0)
+                      break;
+              }
+
+              output.resize(INFLATE_BLOCK);
+              ZstdOutBuffer to = { &output[0], output.size(), 0 };
+              // 0 once a frame is complete, more frames may follow
+              hint = zstd->decompressStream(stream, &to, &from);
+              if (zstd->isError(hint))
+                  throw Error(std::string("corrupted ").append(_file).append(" : ")
+                              .append(zstd->getErrorName(hint)));
+
+              full = (to.pos == to.size);
+              output.resize(to.pos);
+              if (!output.empty() && !push(output))
+              {
+                  stopped = true;
+                  break;
+              }
+          }
+          if (hint != 0 && !stopped)
+              throw Error(std::string("truncated ").append(_file));
+      }
+      catch (...)
+      {
+          zstd->freeDStream(stream);
+          throw;
+      }
+      zstd->freeDStream(stream);
+  }
+
+  /*
+  ** PROJECTION
+  */
+
+  Projection::Projection(void) {}
+
+  Projection::Projection(std::initializer_list<unsigned int> columns)
+      : _columns(columns) {}
+
+  Projection::Projection(std::initializer_list<std::string> names)
+      : _names(names) {}
+
+  Projection::Projection(const std::vector<unsigned int> &columns)
+      : _columns(columns) {}
+
+  Projection::Projection(const std::vector<std::string> &names)
+      : _names(names) {}
+
+  bool Projection::empty(void) const
+  {
+      return _columns.empty() && _names.empty();
+  }
+
+  unsigned int Projection::size(void) const
+  {
+      return _columns.size();
+  }
+
+  int Projection::slot(std::size_t column) const
+  {
+      if (column < _slots.size())
+          return _slots[column];
+      return -1;
+  }
+
+  std::vector<std::string> Projection::bind(const std::vector<std::string> &header)
+  {
+      // names are turned into positions once the header is known
+      if (!_names.empty())
+      {
+          _columns.clear();
+          for (auto name = _names.begin(); name != _names.end(); name++)
+          {
+              auto it = std::find(header.begin(), header.end(), *name);
+              if (it == header.end())
+                  throw Error(std::string("can't project on ").append(*name).append(" (doesn't exist)"));
+              _columns.push_back(it - header.begin());
+          }
+      }
+
+      std::vector<std::string> projected;
+      _slots.assign(header.size(), -1);
+      for (unsigned int i = 0; i < _columns.size(); i++)
+      {
+          if (_columns[i] >= header.size())
+              throw Error("can't project on this column (doesn't exist)");
+          if (_slots[_columns[i]] != -1)
+              throw Error("can't project twice on the same column");
+          _slots[_columns[i]] = i;
+          projected.push_back(header[_columns[i]]);
+      }
+      return projected;
+  }
+
+  /*
+  ** HEADER
+  */
+
+  Header::Header(const std::vector<std::string> &names)
+      : _names(names)
+  {
+      // a repeated name resolves to its first column, as a scan would
+      for (unsigned int i = 0; i < _names.size(); i++)
+          _index.emplace(_names[i], i);
+  }
+
+  unsigned int Header::size(void) const
+  {
+      return _names.size();
+  }
+
+  const std::vector<std::string> &Header::names(void) const
+  {
+      return _names;
+  }
+
+  int Header::find(const std::string &name) const
+  {
+      auto it = _index.find(name);
+      if (it == _index.end())
+          return -1;
+      return it->second;
+  }
+
+  unsigned int Header::column(const std::string &name) const
+  {
+      int pos = find(name);
+      if (pos < 0)
+          throw Error(std::string("can't find column ").append(name).append(" (doesn't exist)"));
+      return pos;
+  }
+
+  /*
+  ** MAPPEDFILE
+  */
+
+  MappedFile::MappedFile(void)
+      : _addr(nullptr), _length(0) {}
+
+  MappedFile::~MappedFile(void)
+  {
+      if (_addr != nullptr)
+          munmap(_addr, _length);
+  }
+
+  void MappedFile::open(const std::string &path)
+  {
+      if (_addr != nullptr)
+          munmap(_addr, _length);
+      _addr = nullptr;
+      _length = 0;
+
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+          throw Error(std::string("Failed to open ").append(path));
+
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+      {
+          ::close(fd);
+          throw Error(std::string("Failed to open ").append(path));
+      }
+
+      // an empty file can't be mapped, it is reported as "No Data" later
+      if (st.st_size > 0)
+      {
+          void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (addr == MAP_FAILED)
+          {
+              ::close(fd);
+              throw Error(std::string("Failed to map ").append(path));
+          }
+          _addr = addr;
+          _length = st.st_size;
+          madvise(_addr, _length, MADV_SEQUENTIAL);
+      }
+      ::close(fd);
+  }
+
+  std::string_view MappedFile::data(void) const
+  {
+      return std::string_view(static_cast<const char *>(_addr), _length);
+  }
+
+  /*
+  ** ROW
+  */
+
+  Row::Row(const Header *header, const char *base, const char *arena,
+           const Field *fields, unsigned int size, Parser *owner, std::size_t index)
+      : _header(header), _base(base), _arena(arena), _fields(fields), _size(size),
+        _owner(owner), _index(index) {}
+
+  Row::~Row(void) {}
+
+  unsigned int Row::size(void) const
+  {
+    return _size;
+  }
+
+  bool Row::set(const std::string &key, const std::string &value) 
+  {
+    // rows of a const Parser or of a Stream are read only
+    if (_owner == nullptr)
+      return false;
+    return _owner->set(_index, key, value);
+  }
+
+  std::string_view Row::view(unsigned int valuePosition) const
+  {
+       if (valuePosition >= _size)
+           throw Error("can't return this value (doesn't exist)");
+
+       const Field &field = _fields[valuePosition];
+       if (field.length & Field::ARENA)
+           return std::string_view(_arena + field.offset, field.length & ~Field::ARENA);
+       return std::string_view(_base + field.offset, field.length);
+  }
+
+  long long Row::getInt(unsigned int valuePosition) const
+  {
+       return toInt(view(valuePosition));
+  }
+
+  double Row::getDouble(unsigned int valuePosition) const
+  {
+       return toDouble(view(valuePosition));
+  }
+
+  double Row::getCurrency(unsigned int valuePosition) const
+  {
+       return toCurrency(view(valuePosition));
+  }
+
+  unsigned int Row::getCode(unsigned int valuePosition, Dictionary &dictionary) const
+  {
+       return dictionary.code(view(valuePosition));
+  }
+
+  const std::string Row::operator[](unsigned int valuePosition) const
+  {
+       return std::string(view(valuePosition));
+  }
+
+  const std::string Row::operator[](const std::string &key) const
+  {
+      int pos = _header->find(key);
+
+      if (pos < 0 || static_cast<unsigned int>(pos) >= _size)
+          throw Error("can't return this value (doesn't exist)");
+      return std::string(view(pos));
   }
 
   std::ostream &operator<<(std::ostream &os, const Row &row)
   {
-      for (unsigned int i = 0; i != row._values.size(); i++)
-          os << row._values[i] << " | ";
+      for (unsigned int i = 0; i != row.size(); i++)
+          os << row.view(i) << " | ";
 
       return os;
   }
 
   std::ofstream &operator<<(std::ofstream &os, const Row &row)
   {
-    for (unsigned int i = 0; i != row._values.size(); i++)
+    for (unsigned int i = 0; i != row.size(); i++)
     {
-        os << row._values[i];
-        if (i < row._values.size() - 1)
+        os << row.view(i);
+        if (i < row.size() - 1)
           os << ",";
     }
     return os;
@@ -1,10 +1,23 @@
 #ifndef     _CSVPARSER_HPP_
 # define    _CSVPARSER_HPP_
 
+# include <algorithm>
+# include <atomic>
+# include <condition_variable>
+# include <cstdint>
+# include <deque>
+# include <exception>
+# include <fstream>
+# include <initializer_list>
+# include <mutex>
 # include <stdexcept>
 # include <string>
+# include <string_view>
+# include <thread>
+# include <type_traits>
+# include <unordered_map>
 # include <vector>
-# include <list>
+# include <memory>
 # include <sstream>
 
 namespace csv
@@ -19,36 +32,405 @@ namespace csv
         }
     };
 
+    /*
+    ** Read-only memory mapping of a whole file, unmapped on destruction
+    */
+    class MappedFile
+    {
+      public:
+        MappedFile(void);
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile(void);
+
+      public:
+        void open(const std::string &);
+        std::string_view data(void) const;
+
+      private:
+        void *_addr;
+        std::size_t _length;
+    };
+
+    /*
+    ** Inflates a gzip or zstd file on a background thread, a few blocks
+    ** ahead of the reader, so decompression overlaps with parsing and
+    ** nothing is written to disk. The format is told by the magic bytes.
+    ** gzip goes through zlib, zstd through libzstd loaded when first
+    ** needed, which is not a build dependency.
+    */
+    class Inflater
+    {
+      public:
+        static bool compressed(const std::string &);
+
+      public:
+        Inflater(const std::string &);
+        Inflater(const Inflater &) = delete;
+        Inflater &operator=(const Inflater &) = delete;
+        ~Inflater(void);
+
+      public:
+        std::size_t read(char *, std::size_t);
+        std::uint64_t consumed(void) const;
+
+      protected:
+        void run(void);
+        void inflateGzip(std::ifstream &);
+        void inflateZstd(std::ifstream &);
+        bool push(std::string &);
+
+      private:
+        std::string _file;
+        std::atomic<std::uint64_t> _consumed;
+
+        // blocks inflated and not read yet, at most QUEUE of them
+        std::mutex _lock;
+        std::condition_variable _ready;
+        std::condition_variable _space;
+        std::deque<std::string> _blocks;
+        bool _done;
+        bool _stop;
+        std::exception_ptr _error;
+
+        std::string _current;
+        std::size_t _pos;
+        std::thread _worker;
+    };
+
+    /*
+    ** Columns to keep from each record, by position or by header name,
+    ** in the order they should appear in the rows. An empty projection
+    ** keeps every column. Dropped fields are never stored.
+    */
+    class Projection
+    {
+      public:
+        Projection(void);
+        Projection(std::initializer_list<unsigned int>);
+        Projection(std::initializer_list<std::string>);
+        Projection(const std::vector<unsigned int> &);
+        Projection(const std::vector<std::string> &);
+
+      public:
+        bool empty(void) const;
+        unsigned int size(void) const;
+        int slot(std::size_t column) const;
+        std::vector<std::string> bind(const std::vector<std::string> &);
+
+      private:
+        std::vector<unsigned int> _columns;
+        std::vector<std::string> _names;
+        std::vector<int> _slots;
+    };
+
+    /*
+    ** Column names, shared by every row of a Parser or Stream, with the
+    ** name to position index built once. column() lets a loader look a
+    ** name up once and then read rows by position.
+    */
+    class Header
+    {
+      public:
+        Header(const std::vector<std::string> &);
+
+      public:
+        unsigned int size(void) const;
+        const std::vector<std::string> &names(void) const;
+        int find(const std::string &) const;
+        unsigned int column(const std::string &) const;
+
+      private:
+        std::vector<std::string> _names;
+        std::unordered_map<std::string, unsigned int> _index;
+    };
+
+    /*
+    ** Interns the values of a low-cardinality column (a fund, a department,
+    ** a pay status) : each distinct value is stored once and stands for a
+    ** small code, so records hold and compare codes instead of strings.
+    ** Code 0 is the empty value.
+    */
+    class Dictionary
+    {
+      public:
+        Dictionary(void);
+        Dictionary(const Dictionary &) = delete;
+        Dictionary &operator=(const Dictionary &) = delete;
+
+      public:
+        unsigned int code(std::string_view);
+        int find(std::string_view) const;
+        const std::string &value(unsigned int) const;
+        unsigned int size(void) const;
+
+      private:
+        // a deque never moves its strings, the index keys are views on them
+        std::deque<std::string> _values;
+        std::unordered_map<std::string_view, unsigned int> _codes;
+    };
+
+    /*
+    ** Records a lenient Parser or Stream left out, counted by reason. The
+    ** first KEPT of them are kept with their line number in the file and
+    ** the start of their text, for the report.
+    */
+    class Rejects
+    {
+      public:
+        enum Reason {
+            eMISSING_FIELDS = 0,
+            eEXTRA_FIELDS = 1,
+            eLINE_TOO_LONG = 2,
+            eBAD_VALUE = 3
+        };
+        static const unsigned int REASONS = 4;
+        static const std::size_t KEPT = 100;
+        static const std::size_t KEPT_TEXT = 256;
+
+        struct Reject
+        {
+            std::size_t line;
+            Reason reason;
+            std::string text;
+        };
+
+      public:
+        Rejects(void);
+
+      public:
+        void add(Reason, std::size_t line, std::string_view text);
+        void merge(const Rejects &, std::size_t lineShift);
+        std::size_t count(Reason) const;
+        std::size_t total(void) const;
+        const std::vector<Reject> &kept(void) const;
+        static const char *describe(Reason);
+        friend std::ostream &operator<<(std::ostream &, const Rejects &);
+
+      private:
+        std::size_t _counts[REASONS];
+        std::vector<Reject> _kept;
+    };
+
+    /*
+    ** What to do with a record that does not fit the header : eSTRICT
+    ** throws, eLENIENT leaves it out and counts it in the Rejects.
+    */
+    enum ErrorMode {
+        eSTRICT = 0,
+        eLENIENT = 1
+    };
+
+    /*
+    ** Field splitting and number conversions used by Row, for code that
+    ** works on lines itself. split() stores the first size fields of line
+    ** as views into it and returns how many fields there are.
+    */
+    std::size_t split(std::string_view line, char sep, std::string_view *fields,
+                      std::size_t size);
+    long long parseInt(std::string_view);
+    double parseDouble(std::string_view);
+    double parseCurrency(std::string_view);
+    long long parseCents(std::string_view);
+
+    /*
+    ** The quoted areas of a buffer : bit i of the mask (bit i % 64 of word
+    ** i / 64) is set when byte i is inside double quotes, an opening quote
+    ** included. quoteMask runs the vector scan split() uses, quoteMaskScalar
+    ** looks at one byte at a time, and both give the same bits. The mask
+    ** holds (size + 63) / 64 words.
+    */
+    void quoteMask(std::string_view buffer, uint64_t *mask);
+    void quoteMaskScalar(std::string_view buffer, uint64_t *mask);
+
+    /*
+    ** Columns of a compile-time Schema : which column of the file goes to
+    ** which member of the record. Col converts by the member type (text,
+    ** integer or floating point), Currency reads amounts like "$1,234.50"
+    ** (as a number of cents into an integer member) and Code interns the
+    ** value in a Dictionary. Parsed converts with a function of the field,
+    ** whose zero value means the field is not valid : the record is then
+    ** rejected. store() returns whether the field was taken.
+    */
+    template<unsigned int N, auto Member>
+    struct Col
+    {
+        static const unsigned int column = N;
+
+        template<typename T>
+        static bool store(T &record, std::string_view field)
+        {
+            auto &member = record.*Member;
+            typedef typename std::remove_reference<decltype(member)>::type Type;
+
+            if constexpr (std::is_integral<Type>::value)
+                member = static_cast<Type>(parseInt(field));
+            else if constexpr (std::is_floating_point<Type>::value)
+                member = static_cast<Type>(parseDouble(field));
+            else
+                member.assign(field.data(), field.size());
+            return true;
+        }
+    };
+
+    template<unsigned int N, auto Member>
+    struct Currency
+    {
+        static const unsigned int column = N;
+
+        template<typename T>
+        static bool store(T &record, std::string_view field)
+        {
+            auto &member = record.*Member;
+            typedef typename std::remove_reference<decltype(member)>::type Type;
+
+            if constexpr (std::is_integral<Type>::value)
+                member = static_cast<Type>(parseCents(field));
+            else
+                member = static_cast<Type>(parseCurrency(field));
+            return true;
+        }
+    };
+
+    template<unsigned int N, auto Member, Dictionary &D>
+    struct Code
+    {
+        static const unsigned int column = N;
+
+        template<typename T>
+        static bool store(T &record, std::string_view field)
+        {
+            record.*Member = D.code(field);
+            return true;
+        }
+    };
+
+    template<unsigned int N, auto Member, auto Parse>
+    struct Parsed
+    {
+        static const unsigned int column = N;
+
+        template<typename T>
+        static bool store(T &record, std::string_view field)
+        {
+            auto value = Parse(field);
+
+            if (value == decltype(value)())
+                return false;
+            record.*Member = value;
+            return true;
+        }
+    };
+
+    /*
+    ** Decoder for a fixed file layout, the column to member mapping being
+    ** resolved by the compiler :
+    **
+    **   typedef csv::Schema<Bid,
+    **                       csv::Parsed<1, &Bid::bidId, &Bid::parseId>,
+    **                       csv::Col<0, &Bid::title>,
+    **                       csv::Code<8, &Bid::fund, funds>,
+    **                       csv::Currency<4, &Bid::amount> > BidSchema;
+    **
+    **   while (stream.read<BidSchema>(bid)) ...
+    **
+    ** Each line is split once, as far as the last wanted column, and the
+    ** fields go straight into the record : no Row, no Header lookups. A
+    ** record with a field its column turns down is a bad value.
+    */
+    template<typename T, typename... Cols>
+    struct Schema
+    {
+        typedef T Record;
+        static constexpr unsigned int WIDTH = std::max({ Cols::column... }) + 1;
+
+        static bool decode(std::string_view line, char sep, unsigned int columns,
+                           T &record, Rejects::Reason &reason)
+        {
+            std::string_view fields[WIDTH];
+            std::size_t count = split(line, sep, fields, WIDTH);
+
+            if (count != columns)
+            {
+                reason = (count < columns) ? Rejects::eMISSING_FIELDS : Rejects::eEXTRA_FIELDS;
+                return false;
+            }
+            if (!(Cols::store(record, fields[Cols::column]) && ...))
+            {
+                reason = Rejects::eBAD_VALUE;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    class Parser;
+
+    /*
+    ** Where a field sits : offset and length from the start of its line,
+    ** or from the start of the Parser's arena when the length carries
+    ** the ARENA bit (values written through addRow/set).
+    */
+    struct Field
+    {
+        static const uint32_t ARENA = 0x80000000u;
+
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    /*
+    ** A Row is a light handle on fields stored by a Parser or a Stream,
+    ** and hands out views into that storage. Rows and their views are
+    ** valid until the Parser is modified (addRow, deleteRow, set) or the
+    ** Stream moves to the next record.
+    */
     class Row
     {
     	public:
-    	    Row(const std::vector<std::string> &);
+    	    Row(const Header *, const char *base, const char *arena,
+    	        const Field *, unsigned int size,
+    	        Parser *owner = nullptr, std::size_t index = 0);
     	    ~Row(void);
 
     	public:
             unsigned int size(void) const;
-            void push(const std::string &);
-            bool set(const std::string &, const std::string &); 
+            bool set(const std::string &, const std::string &);
+            std::string_view view(unsigned int) const;
 
     	private:
-    		const std::vector<std::string> _header;
-    		std::vector<std::string> _values;
+    		const Header *_header;
+    		const char *_base;
+    		const char *_arena;
+    		const Field *_fields;
+    		unsigned int _size;
+    		Parser *_owner;
+    		std::size_t _index;
 
         public:
 
             template<typename T>
             const T getValue(unsigned int pos) const
             {
-                if (pos < _values.size())
+                if (pos < _size)
                 {
                     T res;
                     std::stringstream ss;
-                    ss << _values[pos];
+                    ss << view(pos);
                     ss >> res;
                     return res;
                 }
                 throw Error("can't return this value (doesn't exist)");
             }
+
+            // read straight from the field, without building a string or
+            // a stream. Like atoi/atof they read as much of a number as
+            // there is and give 0 when there is none
+            long long getInt(unsigned int pos) const;
+            double getDouble(unsigned int pos) const;
+            double getCurrency(unsigned int pos) const;
+            unsigned int getCode(unsigned int pos, Dictionary &) const;
+
             const std::string operator[](unsigned int) const;
             const std::string operator[](const std::string &valueName) const;
             friend std::ostream& operator<<(std::ostream& os, const Row &row);
@@ -57,43 +439,237 @@ namespace csv
 
     enum DataType {
         eFILE = 0,
-        ePURE = 1
+        ePURE = 1,
+        eMAPPED = 2
+    };
+
+    /*
+    ** How sync() persists changes. eREWRITE writes the whole file every
+    ** time. eAPPEND appends the added rows to the file and records the
+    ** deleted ones in a tombstone file next to it (<file>.del, one record
+    ** number per line), which Parser and Stream skip when reading, in
+    ** either mode : an eREWRITE Parser rewrites the file without them. The
+    ** file is only rewritten, and the tombstones dropped, once they make
+    ** up a quarter of it or after a change appending cannot express (a
+    ** row inserted before the end, a stored row modified).
+    */
+    enum SyncMode {
+        eREWRITE = 0,
+        eAPPEND = 1
     };
 
+    /*
+    ** With threads > 1, large inputs are cut into that many chunks which
+    ** are parsed in parallel, rows keep the order of the file. A lenient
+    ** parser can't rewrite a file it rejected records from, as they would
+    ** be lost, only append to it. A compressed file is inflated in memory
+    ** (eMAPPED reads it as eFILE) and can't be synced.
+    */
     class Parser
     {
 
     public:
-        Parser(const std::string &, const DataType &type = eFILE, char sep = ',');
+        Parser(const std::string &, const DataType &type = eFILE, char sep = ',',
+               unsigned int threads = 1, const Projection &projection = Projection(),
+               const ErrorMode &errors = eSTRICT);
+        Parser(const Parser &) = delete;
+        Parser &operator=(const Parser &) = delete;
         ~Parser(void);
 
     public:
-        Row &getRow(unsigned int row) const;
+        Row getRow(unsigned int row);
+        Row getRow(unsigned int row) const;
         unsigned int rowCount(void) const;
         unsigned int columnCount(void) const;
         std::vector<std::string> getHeader(void) const;
         const std::string getHeaderElement(unsigned int pos) const;
+        unsigned int column(const std::string &) const;
         const std::string &getFileName(void) const;
+        const Rejects &rejects(void) const;
 
     public:
         bool deleteRow(unsigned int row);
         bool addRow(unsigned int pos, const std::vector<std::string> &);
-        void sync(void) const;
+        bool set(unsigned int row, const std::string &, const std::string &);
+        void setSyncMode(SyncMode);
+        void sync(void);
+        void compact(void);
 
     protected:
-    	void parseHeader(void);
+    	bool parseHeader(void);
     	void parseContent(void);
+    	void dropTombstones(void);
+    	bool appendable(void) const;
+    	void append(void);
+    	void rewrite(void);
+    	void write(std::ofstream &, bool header, std::size_t first) const;
+    	Field store(std::string_view);
 
     private:
         std::string _file;
         const DataType _type;
         const char _sep;
-        std::vector<std::string> _originalFile;
-        std::vector<std::string> _header;
-        std::vector<Row *> _content;
+        const unsigned int _threads;
+        Projection _projection;
+        const ErrorMode _errors;
+        Rejects _rejects;
+        bool _compressed;
+        unsigned int _columns;
+        std::string _buffer;
+        MappedFile _mapped;
+        std::string_view _text;
+        std::string_view _body;
+        std::shared_ptr<const Header> _header;
+
+        // every parsed row is one record and a slice of the field table,
+        // the field bytes stay in the text itself. number is the position
+        // of the record in the file, UNSTORED until a sync writes it
+        struct Record
+        {
+            static const unsigned int UNSTORED = ~0u;
+
+            std::size_t base;
+            std::size_t first;
+            unsigned int size;
+            unsigned int number;
+        };
+        std::vector<Record> _records;
+        std::vector<Field> _fields;
+        std::string _arena;
+
+        // what the file holds, for eAPPEND : records written to it, how
+        // many of them are tombstoned and the tombstones not written yet
+        SyncMode _mode;
+        std::size_t _stored;
+        std::size_t _dead;
+        std::vector<unsigned int> _tombstones;
+        bool _rewrite;
+
+        std::size_t parseRange(std::string_view, std::vector<Record> &, std::vector<Field> &,
+                               Rejects &) const;
+        Row makeRow(unsigned int, Parser *) const;
+
+    public:
+        Row operator[](unsigned int row);
+        Row operator[](unsigned int row) const;
+    };
+
+    /*
+    ** Forward-only reader : the file is read one block at a time and a
+    ** single Row is refilled for every record, so memory use does not
+    ** depend on the size of the input.
+    **
+    **   for (auto &row : csv::Stream(path)) ...
+    **
+    ** The row handed out is only valid until the stream moves on. Records
+    ** tombstoned by a Parser in eAPPEND mode are skipped.
+    **
+    ** A following stream works like tail -f on a file that is still being
+    ** written : a record is only handed out once its newline is there, and
+    ** once the end is reached a later next() (or a new range-for) picks up
+    ** the records appended since. offset() tells how far the file has been
+    ** read, seek() resumes another stream from there; line numbers in the
+    ** rejects are then counted from that point.
+    **
+    ** A compressed file is inflated as it is read, offsets count inflated
+    ** bytes, and it can't be followed or seeked.
+    */
+    class Stream
+    {
+
+    public:
+        Stream(const std::string &, char sep = ',', std::size_t blockSize = 1 << 16);
+        Stream(const std::string &, const Projection &, char sep = ',',
+               std::size_t blockSize = 1 << 16);
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+        ~Stream(void);
+
+    public:
+        bool next(void);
+        const Row &getRow(void) const;
+
+        // decode the next record straight into record, see Schema
+        template<typename S>
+        bool read(typename S::Record &record)
+        {
+            std::string_view line;
+            Rejects::Reason reason;
+
+            if (_columns < S::WIDTH)
+                throw Error(std::string("not enough columns for the schema in ").append(_file));
+            while (nextRecord(line))
+            {
+                if (S::decode(line, _sep, _columns, record, reason))
+                    return true;
+                reject(reason, line);
+            }
+            return false;
+        }
+        const std::vector<std::string> &getHeader(void) const;
+        unsigned int column(const std::string &) const;
+        const std::string &getFileName(void) const;
+        const Rejects &rejects(void) const;
 
     public:
-        Row &operator[](unsigned int row) const;
+        void setErrorMode(ErrorMode);
+        void setFollow(bool);
+        std::uint64_t offset(void) const;
+        std::uint64_t consumed(void) const;
+        void seek(std::uint64_t);
+
+    public:
+        class iterator
+        {
+          public:
+            iterator(Stream *stream) : _stream(stream) {}
+            const Row &operator*(void) const { return _stream->getRow(); }
+            const Row *operator->(void) const { return &_stream->getRow(); }
+            iterator &operator++(void)
+            {
+                if (!_stream->next())
+                    _stream = nullptr;
+                return *this;
+            }
+            bool operator==(const iterator &o) const { return _stream == o._stream; }
+            bool operator!=(const iterator &o) const { return _stream != o._stream; }
+
+          private:
+            Stream *_stream;
+        };
+
+        iterator begin(void);
+        iterator end(void);
+
+    protected:
+        bool readLine(std::string_view &);
+        bool nextRecord(std::string_view &);
+        void reject(Rejects::Reason, std::string_view);
+        void refill(void);
+
+    private:
+        std::string _file;
+        const char _sep;
+        Projection _projection;
+        unsigned int _columns;
+        std::ifstream _input;
+        std::unique_ptr<Inflater> _inflater;
+        std::string _buffer;
+        std::size_t _pos;
+        std::size_t _end;
+        std::uint64_t _base;
+        std::uint64_t _first;
+        bool _eof;
+        bool _follow;
+        ErrorMode _errors;
+        Rejects _rejects;
+        std::size_t _line;
+        std::vector<unsigned int> _skip;
+        std::size_t _skipPos;
+        unsigned int _number;
+        std::shared_ptr<const Header> _header;
+        std::vector<Field> _fields;
+        Row _row;
     };
 }
 
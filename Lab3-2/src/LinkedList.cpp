@@ -10,8 +10,12 @@
 
 #include <algorithm>
 #include <iostream>
+#include <string_view>
 #include <time.h>
+#include <utility>
 
+#include "Bid.hpp"
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
 
 using namespace std;
@@ -20,21 +24,6 @@ using namespace std;
 // Global definitions visible to all methods and classes
 //============================================================================
 
-// forward declarations
-double strToDouble(string str, char ch);
-
-// define a structure to hold bid information
-struct Bid {
-    string bidId; // unique identifier
-    string title;
-    string fund;
-    double amount;
-    // constructor will be automatically called when a new bid is created
-    Bid() {
-        amount = 0.0;
-    }
-};
-
 //============================================================================
 // Linked-List class definition
 //============================================================================
@@ -56,10 +45,15 @@ private:
     	next = nullptr;
     }
     // constructor used to initialize a node with a bid
-    Node(Bid aBid){
+    Node(const Bid &aBid){
     	bid = aBid;
     	next = nullptr;
     }
+    // build the bid in place from the arguments of one of its constructors
+    template<typename... Args>
+    Node(std::in_place_t, Args&&... args)
+      : bid(std::forward<Args>(args)...), next(nullptr) {
+    }
 
 
   };
@@ -72,11 +66,18 @@ private:
 public:
     LinkedList();
     virtual ~LinkedList();
-    void Append(Bid bid);
-    void Prepend(Bid bid);
+    void Clear();
+    const Bid &Append(const Bid &bid);
+    const Bid &Prepend(const Bid &bid);
+    template<typename... Args>
+    const Bid &EmplaceBack(Args&&... args);
+    template<typename... Args>
+    const Bid &EmplaceFront(Args&&... args);
     void PrintList();
-    void Remove(string bidId);
-    Bid Search(string bidId);
+    void Remove(unsigned int bidId);
+    void Remove(string_view bidId);
+    const Bid *Search(unsigned int bidId) const;
+    const Bid *Search(string_view bidId) const;
     int Size();
 };
 
@@ -95,15 +96,42 @@ LinkedList::LinkedList() {
  * Destructor
  */
 LinkedList::~LinkedList() {
+	Clear();
+}
+
+/**
+ * Remove every bid
+ */
+void LinkedList::Clear() {
+	while (head != nullptr) {
+		Node* next = head->next;
+		delete head;
+		head = next;
+	}
+	tail = nullptr;
+	size = 0;
 }
 
 /**
  * Append a new bid to the end of the list
+ *
+ * @return The bid as stored in the list
  */
-void LinkedList::Append(Bid bid) {
+const Bid &LinkedList::Append(const Bid &bid) {
+    return EmplaceBack(bid);
+}
+
+/**
+ * Append a new bid built in its node from the arguments of one of its
+ * constructors
+ *
+ * @return The bid as stored in the list
+ */
+template<typename... Args>
+const Bid &LinkedList::EmplaceBack(Args&&... args) {
     // Implement append logic
-	// create a node pointer from the bid that's passed in
-   Node *node = new Node(bid);
+	// create a node pointer holding the bid built from the arguments
+   Node *node = new Node(std::in_place, std::forward<Args>(args)...);
 
    if(head == nullptr){
 	   head = node;
@@ -117,23 +145,42 @@ void LinkedList::Append(Bid bid) {
    tail = node;
    // increment the size of the list with every bid added
    size++;
+   return node->bid;
 }
 
 /**
  * Prepend a new bid to the start of the list
+ *
+ * @return The bid as stored in the list
  */
-void LinkedList::Prepend(Bid bid) {
+const Bid &LinkedList::Prepend(const Bid &bid) {
+    return EmplaceFront(bid);
+}
+
+/**
+ * Prepend a new bid built in its node from the arguments of one of its
+ * constructors
+ *
+ * @return The bid as stored in the list
+ */
+template<typename... Args>
+const Bid &LinkedList::EmplaceFront(Args&&... args) {
     // Implement prepend logic
-	// create a node pointer from the bid that's passed in
-	  Node *node = new Node(bid);
+	// create a node pointer holding the bid built from the arguments
+	  Node *node = new Node(std::in_place, std::forward<Args>(args)...);
 	  //if head is not null, we want the bid we are appending to be the head of the list and it's next pointer points to what was
 	  //already in the head
 	  if(head != nullptr){
 		  node-> next = head;
 	  }
      head = node;
+     // the first node is also the last one
+     if(tail == nullptr){
+    	 tail = node;
+     }
      // increment size of list because of inserting
      size++;
+     return node->bid;
 }
 
 /**
@@ -145,7 +192,7 @@ void LinkedList::PrintList() {
 	Node *current = head;
 	// loop over each node and print the information for each bid that is in the list
 	while(current != nullptr){
-		cout << current->bid.bidId << ": " << current-> bid.title<< " | "<<current-> bid.amount <<" | "<< current-> bid.fund <<endl;
+		cout << current->bid.bidId << ": " << current-> bid.getTitle()<< " | "<<current-> bid.getAmount() <<" | "<< current->bid.getFund() <<endl;
 		current = current->next;
 	}
 }
@@ -155,11 +202,11 @@ void LinkedList::PrintList() {
  *
  * @param bidId The bid id to remove from the list
  */
-void LinkedList::Remove(string bidId) {
+void LinkedList::Remove(unsigned int bidId) {
    // Implement remove logic
    // case for when item to be removed is in the head position
 	if (head != nullptr) {
-		if (head->bid.bidId.compare(bidId) ==0) {
+		if (head->bid.bidId == bidId) {
 			Node* tempNode = head->next;
 			delete head;
 			head = tempNode;
@@ -170,7 +217,7 @@ void LinkedList::Remove(string bidId) {
 
 	// loop over each node looking for a match
 	while (current->next != nullptr) {
-		if (current->next->bid.bidId.compare(bidId) == 0) {
+		if (current->next->bid.bidId == bidId) {
 			//save the next node (one to be removed)
 			Node* tempNode = current->next;
 
@@ -190,31 +237,48 @@ void LinkedList::Remove(string bidId) {
 
 }
 
+/**
+ * Remove a specified bid
+ *
+ * @param bidId The bid id to remove from the list, as typed
+ */
+void LinkedList::Remove(string_view bidId) {
+	Remove(Bid::parseId(bidId));
+}
+
 /**
  * Search for the specified bidId
  *
  * @param bidId The bid id to search for
+ * @return The bid in the list, nullptr if there is none
  */
-Bid LinkedList::Search(string bidId) {
+const Bid *LinkedList::Search(unsigned int bidId) const {
 //    // Implement search logic
 
 	//point to the head of the list
-	   Node* current = head;
-	   // set a new node to return an empty bid
-	   Node* bidHolder = new Node;
-	   bidHolder->bid.bidId = "";
+	   const Node* current = head;
 	   // search through and find the bid Id that matches what is passed in
 	   while(current != nullptr){
 	       // if bid id is found, return it
 	       if(current->bid.bidId == bidId){
-	           return current->bid;
+	           return &current->bid;
 	       }
 	       current = current->next;
 	   }
-	   return bidHolder->bid;
+	   return nullptr;
 
 }
 
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for, as typed
+ * @return The bid in the list, nullptr if there is none
+ */
+const Bid *LinkedList::Search(string_view bidId) const {
+	return Search(Bid::parseId(bidId));
+}
+
 /**
  * Returns the current size (number of elements) in the list
  */
@@ -231,9 +295,9 @@ int LinkedList::Size() {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
-    cout << bid.bidId << ": " << bid.title << " | " << bid.amount
-         << " | " << bid.fund << endl;
+void displayBid(const Bid &bid) {
+    cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount()
+         << " | " << bid.getFund() << endl;
     return;
 }
 
@@ -247,19 +311,25 @@ Bid getBid() {
 
     cout << "Enter Id: ";
     cin.ignore();
-    getline(cin, bid.bidId);
+    string bidId;
+    getline(cin, bidId);
+    bid.bidId = Bid::parseId(bidId);
 
     cout << "Enter title: ";
-    getline(cin, bid.title);
+    string title;
+    getline(cin, title);
+    bid.title = Bid::titles.code(title);
 
     cout << "Enter fund: ";
-    cin >> bid.fund;
+    string fund;
+    cin >> fund;
+    bid.fund = Bid::funds.code(fund);
 
     cout << "Enter amount: ";
     cin.ignore();
     string strAmount;
     getline(cin, strAmount);
-    bid.amount = strToDouble(strAmount, '$');
+    bid.amount = csv::parseCents(strAmount);
 
     return bid;
 }
@@ -270,43 +340,59 @@ Bid getBid() {
  * @return a LinkedList containing all the bids read
  */
 void loadBids(string csvPath, LinkedList *list) {
+    // a snapshot of the bids is kept next to the CSV file and mapped
+    // instead of parsing the file again, as long as the file is unchanged
+    string snapPath = csvPath + ".snap";
+    if (snapshot::upToDate(snapPath, csvPath)) {
+        cout << "Loading snapshot " << snapPath << endl;
+        try {
+            snapshot::Reader snap(snapPath);
+            for (unsigned int i = 0; i < snap.size(); i++) {
+                snapshot::Entry entry = snap[i];
+                list->EmplaceBack(entry.bidId, entry.title, entry.fund, entry.amount);
+            }
+            return;
+        } catch (snapshot::Error &e) {
+            std::cerr << e.what() << std::endl;
+            // the bids read so far go, the CSV file is read instead
+            list->Clear();
+        }
+    }
+
     cout << "Loading CSV file " << csvPath << endl;
 
-    // initialize the CSV Parser
-    csv::Parser file = csv::Parser(csvPath);
+    // stream the CSV file one block at a time, so bids are appended
+    // while the rest of the file is still being read. A malformed row
+    // is skipped rather than ending the load
+    csv::Stream file(csvPath);
+    file.setErrorMode(csv::eLENIENT);
+
+    // the snapshot is written again once the whole file has been read
+    snapshot::Writer writer(snapPath, csvPath);
 
     try {
-        // loop to read rows of a CSV file
-        for (int i = 0; i < file.rowCount(); i++) {
+        // decode the rows of the CSV file straight into a bid as they
+        // are read
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
 
-            // initialize a bid using data from current row (i)
-            Bid bid;
-            bid.bidId = file[i][1];
-            bid.title = file[i][0];
-            bid.fund = file[i][8];
-            bid.amount = strToDouble(file[i][4], '$');
+            //cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getFund() << " | " << bid.getAmount() << endl;
 
-            //cout << bid.bidId << ": " << bid.title << " | " << bid.fund << " | " << bid.amount << endl;
+            writer.add(bid.bidId, bid.getTitle(), bid.getFund(), bid.amount);
 
             // add this bid to the end
             list->Append(bid);
         }
+        writer.commit(file.consumed());
     } catch (csv::Error &e) {
         std::cerr << e.what() << std::endl;
+    } catch (snapshot::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
     }
-}
-
-/**
- * Simple C function to convert a string to a double
- * after stripping out unwanted char
- *
- * credit: http://stackoverflow.com/a/24875936
- *
- * @param ch The character to strip out
- */
-double strToDouble(string str, char ch) {
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    return atof(str.c_str());
 }
 
 /**
@@ -338,6 +424,7 @@ int main(int argc, char* argv[]) {
     LinkedList bidList;
 
     Bid bid;
+    const Bid* found;
 
     int choice = 0;
     while (choice != 9) {
@@ -381,12 +468,12 @@ int main(int argc, char* argv[]) {
         case 4:
             ticks = clock();
 
-            bid = bidList.Search(bidKey);
+            found = bidList.Search(bidKey);
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (found != nullptr) {
+                displayBid(*found);
             // this did not work with the instructions given from the video as there was no return type to the Search() method
             } else {
             	cout << "Bid Id " << bidKey << " not found." << endl;
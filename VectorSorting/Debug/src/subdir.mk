@@ -4,14 +4,20 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/Bid.cpp \
+../src/BidSnapshot.cpp \
 ../src/CSVparser.cpp \
 ../src/VectorSorting.cpp 
 
 OBJS += \
+./src/Bid.o \
+./src/BidSnapshot.o \
 ./src/CSVparser.o \
 ./src/VectorSorting.o 
 
 CPP_DEPS += \
+./src/Bid.d \
+./src/BidSnapshot.d \
 ./src/CSVparser.d \
 ./src/VectorSorting.d 
 
@@ -20,7 +26,7 @@ CPP_DEPS += \
 src/%.o: ../src/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -std=c++17 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
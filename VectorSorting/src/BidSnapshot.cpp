@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include "BidSnapshot.hpp"
+
+namespace snapshot {
+
+  static const char MAGIC[8] = { 'B', 'I', 'D', 'S', 'N', 'A', 'P', '4' };
+
+  struct FileHeader
+  {
+      char magic[8];
+      uint64_t count;
+      uint64_t heapSize;
+      uint64_t sourceSize; // how far the bids were read
+      uint64_t fileSize;
+      int64_t sourceTime;
+      uint64_t deletedSize;
+      int64_t deletedTime;
+  };
+
+  static_assert(sizeof(FileHeader) == 64, "snapshot header layout");
+  static_assert(sizeof(Record) == 32, "snapshot record layout");
+
+  /*
+  ** Size and modification time of the CSV a snapshot was made from
+  */
+  static bool sourceStat(const std::string &source, uint64_t &size, int64_t &time)
+  {
+      struct stat st;
+
+      if (stat(source.c_str(), &st) != 0)
+          return false;
+      size = st.st_size;
+      time = st.st_mtime;
+      return true;
+  }
+
+  /*
+  ** Size and modification time of the tombstone file a Parser in eAPPEND
+  ** mode keeps next to the CSV, both 0 when there is none : rows deleted
+  ** that way leave the CSV itself as it was
+  */
+  static void deletedStat(const std::string &source, uint64_t &size, int64_t &time)
+  {
+      if (!sourceStat(source + ".del", size, time))
+      {
+          size = 0;
+          time = 0;
+      }
+  }
+
+  /*
+  ** Whether the CSV holds no newline from offset to its end : past where
+  ** the bids were read there may only be a line still being written
+  */
+  static bool partialTail(const std::string &source, uint64_t offset, uint64_t size)
+  {
+      std::ifstream f(source.c_str(), std::ios::binary);
+      char buffer[4096];
+
+      if (!f.seekg(offset))
+          return false;
+      while (offset < size)
+      {
+          std::size_t wanted = std::min<uint64_t>(sizeof(buffer), size - offset);
+          if (!f.read(buffer, wanted))
+              return false;
+          if (std::memchr(buffer, '\n', wanted) != nullptr)
+              return false;
+          offset += wanted;
+      }
+      return true;
+  }
+
+  bool upToDate(const std::string &path, const std::string &source)
+  {
+      std::ifstream f(path.c_str(), std::ios::binary);
+      FileHeader header;
+      uint64_t size;
+      int64_t time;
+
+      if (!f.read(reinterpret_cast<char *>(&header), sizeof(header)))
+          return false;
+      if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+          return false;
+      if (!sourceStat(source, size, time))
+          return false;
+      if (header.fileSize != size || header.sourceTime != time || header.sourceSize > size)
+          return false;
+      if (!partialTail(source, header.sourceSize, size))
+          return false;
+      deletedStat(source, size, time);
+      return header.deletedSize == size && header.deletedTime == time;
+  }
+
+  /*
+  ** WRITER
+  */
+
+  Writer::Writer(const std::string &path, const std::string &source)
+    : _path(path), _source(source)
+  {
+  }
+
+  void Writer::add(uint32_t bidId, std::string_view title,
+                   std::string_view fund, int64_t amount)
+  {
+      Record record;
+      record.bidId = bidId;
+      record.titleLength = title.size();
+      record.fundLength = fund.size();
+      record.unused = 0;
+      record.amount = amount;
+      record.offset = _heap.size();
+
+      _heap.append(title);
+      _heap.append(fund);
+      _records.push_back(record);
+  }
+
+  void Writer::commit(std::uint64_t sourceSize)
+  {
+      FileHeader header;
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.count = _records.size();
+      header.heapSize = _heap.size();
+      if (!sourceStat(_source, header.fileSize, header.sourceTime))
+          throw Error(std::string("Failed to stat ").append(_source));
+      // rows appended since they were read make the snapshot stale, a
+      // half-written last line left for later does not
+      header.sourceSize = sourceSize;
+      deletedStat(_source, header.deletedSize, header.deletedTime);
+
+      // the old snapshot may be mapped by a reader, never write over it
+      std::string tmp(_path + ".tmp");
+      std::ofstream f(tmp.c_str(), std::ios::binary | std::ios::trunc);
+      f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      f.write(reinterpret_cast<const char *>(_records.data()), _records.size() * sizeof(Record));
+      f.write(_heap.data(), _heap.size());
+      f.close();
+
+      if (!f)
+      {
+          std::remove(tmp.c_str());
+          throw Error(std::string("Failed to write ").append(tmp));
+      }
+      if (std::rename(tmp.c_str(), _path.c_str()) != 0)
+          throw Error(std::string("Failed to replace ").append(_path));
+  }
+
+  /*
+  ** READER
+  */
+
+  Reader::Reader(const std::string &path)
+    : _records(nullptr), _heap(nullptr), _count(0), _heapSize(0), _sourceSize(0)
+  {
+      try
+      {
+          _mapped.open(path);
+      }
+      catch (csv::Error &e)
+      {
+          throw Error(std::string("Failed to open ").append(path));
+      }
+
+      std::string_view data = _mapped.data();
+      FileHeader header;
+
+      if (data.size() < sizeof(header))
+          throw Error(std::string("corrupted snapshot ").append(path));
+      std::memcpy(&header, data.data(), sizeof(header));
+
+      uint64_t available = data.size() - sizeof(header);
+      if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+          || header.count > available / sizeof(Record)
+          || header.heapSize != available - header.count * sizeof(Record))
+          throw Error(std::string("corrupted snapshot ").append(path));
+
+      _count = header.count;
+      _heapSize = header.heapSize;
+      _sourceSize = header.sourceSize;
+      _records = reinterpret_cast<const Record *>(data.data() + sizeof(header));
+      _heap = data.data() + sizeof(header) + _count * sizeof(Record);
+  }
+
+  unsigned int Reader::size(void) const
+  {
+      return _count;
+  }
+
+  std::uint64_t Reader::sourceSize(void) const
+  {
+      return _sourceSize;
+  }
+
+  Entry Reader::operator[](unsigned int pos) const
+  {
+      if (pos >= _count)
+          throw Error("can't return this bid (doesn't exist)");
+
+      const Record &record = _records[pos];
+      uint64_t length = uint64_t(record.titleLength) + record.fundLength;
+      if (record.offset > _heapSize || _heapSize - record.offset < length)
+          throw Error("corrupted snapshot record");
+
+      const char *p = _heap + record.offset;
+      Entry entry;
+
+      entry.bidId = record.bidId;
+      entry.title = std::string_view(p, record.titleLength);
+      p += record.titleLength;
+      entry.fund = std::string_view(p, record.fundLength);
+      entry.amount = record.amount;
+      return entry;
+  }
+}
@@ -9,9 +9,14 @@
 //============================================================================
 
 #include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <time.h>
 
+#include "Bid.hpp"
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
 
 using namespace std;
@@ -23,16 +28,6 @@ using namespace std;
 // forward declarations
 double strToDouble(string str, char ch);
 
-// define a structure to hold bid information
-struct Bid {
-    string bidId; // unique identifier
-    string title;
-    string fund;
-    double amount;
-    Bid() {
-        amount = 0.0;
-    }
-};
 
 //============================================================================
 // Static methods used for testing
@@ -43,9 +38,9 @@ struct Bid {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
-    cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
-            << bid.fund << endl;
+void displayBid(const Bid &bid) {
+    cout << bid.bidId << ": " << bid.getTitle() << " | " << bid.getAmount() << " | "
+            << bid.getFund() << endl;
     return;
 }
 
@@ -59,19 +54,25 @@ Bid getBid() {
 
     cout << "Enter Id: ";
     cin.ignore();
-    getline(cin, bid.bidId);
+    string bidId;
+    getline(cin, bidId);
+    bid.bidId = Bid::parseId(bidId);
 
     cout << "Enter title: ";
-    getline(cin, bid.title);
+    string title;
+    getline(cin, title);
+    bid.title = Bid::titles.code(title);
 
     cout << "Enter fund: ";
-    cin >> bid.fund;
+    string fund;
+    cin >> fund;
+    bid.fund = Bid::funds.code(fund);
 
     cout << "Enter amount: ";
     cin.ignore();
     string strAmount;
     getline(cin, strAmount);
-    bid.amount = strToDouble(strAmount, '$');
+    bid.amount = csv::parseCents(strAmount);
 
     return bid;
 }
@@ -83,36 +84,202 @@ Bid getBid() {
  * @return a container holding all the bids read
  */
 vector<Bid> loadBids(string csvPath) {
-    cout << "Loading CSV file " << csvPath << endl;
-
     // Define a vector data structure to hold a collection of bids.
     vector<Bid> bids;
 
-    // initialize the CSV Parser using the given path
-    csv::Parser file = csv::Parser(csvPath);
+    // a snapshot of the bids is kept next to the CSV file and mapped
+    // instead of parsing the file again, as long as the file is unchanged
+    string snapPath = csvPath + ".snap";
+    if (snapshot::upToDate(snapPath, csvPath)) {
+        cout << "Loading snapshot " << snapPath << endl;
+        try {
+            snapshot::Reader snap(snapPath);
+            bids.reserve(snap.size());
+            for (unsigned int i = 0; i < snap.size(); i++) {
+                snapshot::Entry entry = snap[i];
+                bids.emplace_back(entry.bidId, entry.title, entry.fund, entry.amount);
+            }
+            return bids;
+        } catch (snapshot::Error &e) {
+            std::cerr << e.what() << std::endl;
+            // the bids read so far go, the CSV file is read instead
+            bids.clear();
+        }
+    }
+
+    cout << "Loading CSV file " << csvPath << endl;
+
+    // stream the CSV file one block at a time. Malformed rows are left
+    // out rather than ending the load
+    csv::Stream file(csvPath);
+    file.setErrorMode(csv::eLENIENT);
+
+    // the snapshot is written again once the whole file has been read
+    snapshot::Writer writer(snapPath, csvPath);
 
     try {
-        // loop to read rows of a CSV file
-        for (int i = 0; i < file.rowCount(); i++) {
+        // decode the rows of the CSV file straight into a bid as they
+        // are read
+        Bid bid;
+        while (file.read<BidSchema>(bid)) {
 
-            // Create a data structure and add to the collection of bids
-            Bid bid;
-            bid.bidId = file[i][1];
-            bid.title = file[i][0];
-            bid.fund = file[i][8];
-            bid.amount = strToDouble(file[i][4], '$');
+            //cout << "Item: " << bid.getTitle() << ", Fund: " << bid.getFund() << ", Amount: " << bid.getAmount() << endl;
 
-            //cout << "Item: " << bid.title << ", Fund: " << bid.fund << ", Amount: " << bid.amount << endl;
+            writer.add(bid.bidId, bid.getTitle(), bid.getFund(), bid.amount);
 
             // push this bid to the end
             bids.push_back(bid);
         }
+        writer.commit(file.consumed());
     } catch (csv::Error &e) {
         std::cerr << e.what() << std::endl;
+    } catch (snapshot::Error &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    // malformed rows were left out, say which
+    if (file.rejects().total() > 0) {
+        std::cerr << file.rejects();
     }
     return bids;
 }
 
+/**
+ * Stream every row of a CSV file without keeping any of it, to time the
+ * raw parsing speed. Point it at the sales file replicated to ~1 GB
+ * to get a stable figure.
+ *
+ * @param csvPath the path to the CSV file to scan
+ */
+void scanBids(string csvPath) {
+    cout << "Scanning CSV file " << csvPath << endl;
+
+    unsigned long rows = 0;
+    unsigned long fields = 0;
+
+    // Initialize a timer variable before reading the file
+    clock_t ticks = clock();
+
+    try {
+        csv::Stream file(csvPath);
+        for (auto const& row : file) {
+            rows++;
+            fields += row.size();
+        }
+    } catch (csv::Error &e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+
+    ifstream input(csvPath, ios::binary | ios::ate);
+    double bytes = input.tellg();
+    double seconds = ticks * 1.0 / CLOCKS_PER_SEC;
+
+    cout << rows << " rows, " << fields << " fields scanned" << endl;
+    cout << "time: " << seconds << " seconds" << endl;
+    if (seconds > 0) {
+        cout << "rate: " << bytes / seconds / 1e9 << " GB/s" << endl;
+    }
+}
+
+/**
+ * Time one pass of the quote mask kernel over a buffer, in seconds
+ *
+ * @param kernel csv::quoteMask or csv::quoteMaskScalar
+ * @param buffer the bytes to scan
+ * @param mask where the bits go
+ * @param passes how many times to scan the buffer
+ */
+double timeQuoteKernel(void (*kernel)(string_view, uint64_t*), string_view buffer,
+        vector<uint64_t>& mask, int passes) {
+    clock_t ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        kernel(buffer, mask.data());
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    return ticks * 1.0 / CLOCKS_PER_SEC / passes;
+}
+
+/**
+ * Time the quoted area scan of the tokenizer on its own, the vector
+ * kernel against the byte by byte one, over the same buffer : the whole
+ * CSV file in memory, so neither reading nor splitting is timed. The two
+ * masks must be the same.
+ *
+ * @param csvPath the path to the CSV file to scan
+ */
+void timeQuoteMask(string csvPath) {
+    const int passes = 20;
+
+    ifstream input(csvPath, ios::binary);
+    if (!input) {
+        std::cerr << "can't open " << csvPath << std::endl;
+        return;
+    }
+    string buffer((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+
+    vector<uint64_t> scalarMask((buffer.size() + 63) / 64);
+    vector<uint64_t> vectorMask((buffer.size() + 63) / 64);
+
+    double scalarSeconds = timeQuoteKernel(csv::quoteMaskScalar, buffer, scalarMask, passes);
+    double vectorSeconds = timeQuoteKernel(csv::quoteMask, buffer, vectorMask, passes);
+
+    cout << buffer.size() << " bytes, " << passes << " passes" << endl;
+    if (scalarSeconds > 0) {
+        cout << "scalar: " << buffer.size() / scalarSeconds / 1e9 << " GB/s" << endl;
+    }
+    if (vectorSeconds > 0) {
+        cout << "vector: " << buffer.size() / vectorSeconds / 1e9 << " GB/s" << endl;
+    }
+
+    auto differ = mismatch(scalarMask.begin(), scalarMask.end(), vectorMask.begin());
+    if (differ.first != scalarMask.end()) {
+        std::cerr << "quote masks differ in bytes from "
+                << (differ.first - scalarMask.begin()) * 64 << std::endl;
+        return;
+    }
+    cout << "quote masks match" << endl;
+}
+
+/**
+ * Time the string based amount conversion (a string copy per field,
+ * then strToDouble) against the typed Row::getCurrency accessor, over
+ * the Winning Bid column of every row of a CSV file
+ *
+ * @param csvPath the path to the CSV file to read
+ */
+void timeConversions(string csvPath) {
+    const int passes = 20;
+
+    csv::Parser file(csvPath, csv::eMAPPED, ',', 1, csv::Projection{4});
+
+    double oldTotal = 0.0;
+    clock_t ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (unsigned int i = 0; i < file.rowCount(); ++i) {
+            oldTotal += strToDouble(file[i][0], '$');
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "strToDouble: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    double newTotal = 0.0;
+    ticks = clock();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (unsigned int i = 0; i < file.rowCount(); ++i) {
+            newTotal += file[i].getCurrency(0);
+        }
+    }
+    ticks = clock() - ticks; // current clock ticks minus starting clock ticks
+    cout << "getCurrency: " << ticks << " clock ticks, "
+            << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+
+    cout << passes << " x " << file.rowCount() << " amounts, totals "
+            << oldTotal << " / " << newTotal << endl;
+}
+
 // Implement the quick sort logic over bid.title
 
 /**
@@ -135,11 +302,11 @@ int partition(vector<Bid>& bids, int begin, int end) {
     while(!done){
 
     	// keep incrementing low(or left side) as long as it is less than the pivot
-        while(bids.at(low).title.compare(bids.at(pivot).title) < 0){
+        while(bids.at(low).getTitle().compare(bids.at(pivot).getTitle()) < 0){
         	++low;
         }
     	// keep decrementing high(or right side) as long as it is less than the pivot
-        while(bids.at(pivot).title.compare(bids.at(high).title) < 0){
+        while(bids.at(pivot).getTitle().compare(bids.at(high).getTitle()) < 0){
         	--high;
         }
         if(low >=high){
@@ -204,7 +371,7 @@ void selectionSort(vector<Bid>& bids) {
      min = pos;
         // inner index search throughout the rest of the loop
         for(unsigned j = pos + 1; j < bids.size(); ++j){
-        	if(bids.at(j).title.compare(bids.at(min).title) < 0){
+        	if(bids.at(j).getTitle().compare(bids.at(min).getTitle()) < 0){
         		min = j;
 
         	}
@@ -257,6 +424,9 @@ int main(int argc, char* argv[]) {
         cout << "  2. Display All Bids" << endl;
         cout << "  3. Selection Sort All Bids" << endl;
         cout << "  4. Quick Sort All Bids" << endl;
+        cout << "  5. Time CSV Scanning" << endl;
+        cout << "  6. Time Amount Conversion" << endl;
+        cout << "  7. Time Quote Mask Kernels" << endl;
         cout << "  9. Exit" << endl;
         cout << "Enter choice: ";
         cin >> choice;
@@ -323,6 +493,24 @@ int main(int argc, char* argv[]) {
 
             break;
 
+        // Time the CSV parser on its own
+        case 5:
+            scanBids(csvPath);
+
+            break;
+
+        // Time the amount conversion on its own
+        case 6:
+            timeConversions(csvPath);
+
+            break;
+
+        // Time the quote scan kernels on their own
+        case 7:
+            timeQuoteMask(csvPath);
+
+            break;
+
         }
     }
 